@@ -0,0 +1,342 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <cfloat>
+
+#include "StreetsDatabaseAPI.h"
+#include "routingGraph.h"
+#include "routingFunctions.h"
+#include "routingQueues.h"
+#include "trafficWeights.h"
+#include "threadPool.h"
+#include "altLandmarks.h"
+
+#define NO_EDGE -1
+
+const float UNREACHABLE = std::numeric_limits<float>::infinity();
+
+// Free-flow travel times between every intersection and every landmark, stored intersection-major so the
+// bound for one intersection reads two contiguous rows. Only rebuilt when a map is loaded, so queries read
+// it without synchronization.
+struct LandmarkTimes {
+    std::vector<IntersectionIdx> landmarks;
+    // from_landmark[v * landmarks.size() + k] is the time from landmark k to v, to_landmark the time back
+    std::vector<float> from_landmark;
+    std::vector<float> to_landmark;
+};
+
+// The landmark times are free-flow times, but traffic can make a segment faster than free flow, which
+// would let the bound overestimate. Two corrections keep it a lower bound for the weights they were
+// computed against, and the query uses whichever gives the larger bound:
+//  - scale: the smallest ratio of live to free-flow time over all segments, capped at 1; no path gets
+//    faster than that. Suits traffic that speeds up many segments a little.
+//  - savings: how much faster than free flow all segments together are; no path saves more than that.
+//    Suits a few segments sped up a lot, which would otherwise drag the scale of every bound down.
+struct LandmarkMetric {
+    std::shared_ptr<const WeightSnapshot> weights;
+    double scale;
+    double savings;
+};
+
+// The segments faster than free flow in the last snapshot measured, kept up to date from the changed
+// segments of each update so no update has to look at every segment. Guarded by metric_lock.
+struct FasterSegments {
+    // live / free-flow ratio of every segment, 1 unless it is faster than free flow
+    std::vector<double> ratio;
+    // the ratios below 1, smallest first
+    std::multiset<double> ratios;
+    // free-flow minus live time of every segment faster than free flow, and their sum
+    std::vector<double> saving;
+    double total_saving = 0;
+};
+
+static LandmarkTimes landmark_times;
+// the published metric, only accessed through the std::atomic_load/atomic_store overloads
+static std::shared_ptr<const LandmarkMetric> landmark_metric;
+static std::mutex metric_lock;
+static FasterSegments faster_segments;
+static int landmark_listener = -1;
+
+// every landmark search on a thread shares one queue
+static BinaryHeapQueue& landmarkQueue(){
+    thread_local BinaryHeapQueue queue;
+    return queue;
+}
+
+
+/********************************************************************************/
+/*********************************Preprocessing**********************************/
+/********************************************************************************/
+
+// free-flow dijkstra from a landmark over every reachable intersection, writing column k of times
+// reverse follows the in-edges, giving the time from each intersection to the landmark instead
+static void landmarkSearch(IntersectionIdx landmark, int k, bool reverse, std::vector<float>& times){
+    const RoutingGraph& graph = routing_graph;
+    const std::vector<int>& first = reverse ? graph.first_in : graph.first_out;
+    const std::vector<RoutingEdge>& edges = reverse ? graph.in_edges : graph.out_edges;
+    int num_landmarks = ALT_NUM_LANDMARKS;
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    BinaryHeapQueue& toVisit = landmarkQueue();
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+    toVisit.update(landmark, 0.0);
+    workspace.label(landmark, 0.0, NO_EDGE, NO_EDGE);
+    while (!toVisit.empty()){
+        int curr = toVisit.pop().node;
+        if (workspace.isSettled(curr)){
+            continue;
+        }
+        workspace.settle(curr);
+        double currTime = workspace.time(curr);
+        times[curr * num_landmarks + k] = currTime;
+        for (int e = first[curr]; e < first[curr + 1]; e++){
+            const RoutingEdge& edge = edges[e];
+            double totalTime = currTime + graph.segment_time[edge.segment];
+            if (totalTime < workspace.time(edge.to)){
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+            }
+        }
+    }
+}
+
+// Farthest-point selection: the first landmark is the intersection farthest from an arbitrary start, and
+// every next one is the intersection whose round trip to its closest landmark so far is the longest.
+// Picking is sequential by nature; the two searches of each landmark run in parallel on the worker pool.
+static void selectLandmarks(){
+    const RoutingGraph& graph = routing_graph;
+    int num_intersections = graph.numIntersections();
+    int num_landmarks = ALT_NUM_LANDMARKS;
+    LandmarkTimes& lt = landmark_times;
+    lt.landmarks.clear();
+    lt.from_landmark.assign((size_t)num_intersections * num_landmarks, UNREACHABLE);
+    lt.to_landmark.assign((size_t)num_intersections * num_landmarks, UNREACHABLE);
+    if (num_intersections == 0){
+        return;
+    }
+
+    // seed with the intersection farthest from intersection 0, using column 0 as scratch space
+    landmarkSearch(0, 0, false, lt.from_landmark);
+    IntersectionIdx next = 0;
+    for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+        if (lt.from_landmark[inter * num_landmarks] != UNREACHABLE && lt.from_landmark[inter * num_landmarks] > lt.from_landmark[next * num_landmarks]){
+            next = inter;
+        }
+    }
+    for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+        lt.from_landmark[inter * num_landmarks] = UNREACHABLE;
+    }
+
+    // round trip time from every intersection to its closest landmark so far, infinity if none reaches it
+    std::vector<double> closest(num_intersections, std::numeric_limits<double>::infinity());
+    WorkStealingPool& pool = WorkStealingPool::instance();
+    for (int k = 0; k < num_landmarks && next != -1; k++){
+        lt.landmarks.push_back(next);
+        pool.parallelFor(2, [&](int direction, unsigned){
+            landmarkSearch(next, k, direction == 1, direction == 1 ? lt.to_landmark : lt.from_landmark);
+        });
+
+        next = -1;
+        double farthest = 0;
+        for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+            double round_trip = (double)lt.from_landmark[inter * num_landmarks + k] + lt.to_landmark[inter * num_landmarks + k];
+            closest[inter] = std::min(closest[inter], round_trip);
+            // intersections no landmark connects with both ways are left out, or islands would win every time
+            if (closest[inter] != std::numeric_limits<double>::infinity() && closest[inter] > farthest){
+                farthest = closest[inter];
+                next = inter;
+            }
+        }
+    }
+}
+
+// brings one segment's entry in faster_segments up to date with a snapshot
+static void measureSegment(const std::shared_ptr<const WeightSnapshot>& weights, StreetSegmentIdx seg){
+    const RoutingGraph& graph = routing_graph;
+    FasterSegments& faster = faster_segments;
+    double free_flow = graph.segment_time[seg];
+    double live = weights->time(seg);
+    double ratio = (free_flow > 0 && live < free_flow) ? live / free_flow : 1.0;
+    double saving = std::max(0.0, free_flow - live);
+    if (faster.ratio[seg] < 1.0){
+        faster.ratios.erase(faster.ratios.find(faster.ratio[seg]));
+    }
+    if (ratio < 1.0){
+        faster.ratios.insert(ratio);
+    }
+    faster.ratio[seg] = ratio;
+    faster.total_saving += saving - faster.saving[seg];
+    faster.saving[seg] = saving;
+}
+
+// the metric for a snapshot from faster_segments, once it has been brought up to date with that snapshot
+static std::shared_ptr<const LandmarkMetric> publishedMetric(const std::shared_ptr<const WeightSnapshot>& weights){
+    const FasterSegments& faster = faster_segments;
+    auto metric = std::make_shared<LandmarkMetric>();
+    metric->weights = weights;
+    metric->scale = faster.ratios.empty() ? 1.0 : *faster.ratios.begin();
+    // the running sum can round below the true total, which only costs a sliver of the bound
+    metric->savings = std::max(0.0, faster.total_saving);
+    return metric;
+}
+
+// measures every segment of a snapshot, for a newly built set of landmarks
+static std::shared_ptr<const LandmarkMetric> measureWeights(const std::shared_ptr<const WeightSnapshot>& weights){
+    int num_segments = routing_graph.segment_time.size();
+    FasterSegments& faster = faster_segments;
+    faster.ratio.assign(num_segments, 1.0);
+    faster.ratios.clear();
+    faster.saving.assign(num_segments, 0.0);
+    faster.total_saving = 0;
+    for (StreetSegmentIdx seg = 0; seg < num_segments; seg++){
+        measureSegment(weights, seg);
+    }
+    return publishedMetric(weights);
+}
+
+// weight listener: only the changed segments can have moved in or out of faster_segments
+static void remeasure(const std::shared_ptr<const WeightSnapshot>& weights, const std::vector<StreetSegmentIdx>& changed){
+    std::lock_guard<std::mutex> measure(metric_lock);
+    if (std::atomic_load(&landmark_metric)){
+        for (StreetSegmentIdx seg : changed){
+            measureSegment(weights, seg);
+        }
+        std::atomic_store(&landmark_metric, publishedMetric(weights));
+    }
+}
+
+void buildLandmarks(){
+    clearLandmarks();
+    selectLandmarks();
+    // listen before reading the weights so no update can slip in between
+    landmark_listener = addWeightListener(remeasure);
+    std::lock_guard<std::mutex> measure(metric_lock);
+    std::atomic_store(&landmark_metric, measureWeights(currentWeights()));
+}
+
+void clearLandmarks(){
+    if (landmark_listener != -1){
+        removeWeightListener(landmark_listener);
+        landmark_listener = -1;
+    }
+    std::lock_guard<std::mutex> measure(metric_lock);
+    std::atomic_store(&landmark_metric, std::shared_ptr<const LandmarkMetric>());
+    landmark_times = LandmarkTimes();
+    faster_segments = FasterSegments();
+}
+
+std::vector<IntersectionIdx> landmarkIntersections(){
+    return landmark_times.landmarks;
+}
+
+
+/********************************************************************************/
+/************************************Queries*************************************/
+/********************************************************************************/
+
+std::vector<StreetSegmentIdx> findLandmarkPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty){
+    NoSearchStats stats;
+    return findLandmarkPath(intersect_ids, turn_penalty, stats);
+}
+
+template <class Stats>
+std::vector<StreetSegmentIdx> findLandmarkPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, Stats& stats){
+    std::shared_ptr<const LandmarkMetric> metric = std::atomic_load(&landmark_metric);
+    std::vector<StreetSegmentIdx> path;
+    if (!metric){
+        dijkstra(intersect_ids.first, intersect_ids.second, path, turn_penalty, threadSearchWorkspace(), stats);
+        return path;
+    }
+    const RoutingGraph& graph = routing_graph;
+    const WeightSnapshot& weights = *metric->weights;
+    const LandmarkTimes& lt = landmark_times;
+    IntersectionIdx startID = intersect_ids.first;
+    IntersectionIdx destID = intersect_ids.second;
+    int num_landmarks = ALT_NUM_LANDMARKS;
+    const float* from_dest = &lt.from_landmark[destID * num_landmarks];
+    const float* to_dest = &lt.to_landmark[destID * num_landmarks];
+
+    // Lower bound on the time from inter to the destination, or infinity if the landmarks prove there is no
+    // path: a landmark that reaches inter but not the destination, or that the destination reaches but inter
+    // does not. Each difference of two floats is lowered by their rounding error so it stays a bound.
+    auto lowerBound = [&](IntersectionIdx inter){
+        const float* from_inter = &lt.from_landmark[inter * num_landmarks];
+        const float* to_inter = &lt.to_landmark[inter * num_landmarks];
+        double bound = 0;
+        for (int k = 0; k < (int)lt.landmarks.size(); k++){
+            if (from_inter[k] != UNREACHABLE){
+                if (from_dest[k] == UNREACHABLE){
+                    return std::numeric_limits<double>::infinity();
+                }
+                bound = std::max(bound, (double)from_dest[k] - from_inter[k] - ((double)from_dest[k] + from_inter[k]) * FLT_EPSILON);
+            }
+            if (to_dest[k] != UNREACHABLE){
+                if (to_inter[k] == UNREACHABLE){
+                    return std::numeric_limits<double>::infinity();
+                }
+                bound = std::max(bound, (double)to_inter[k] - to_dest[k] - ((double)to_inter[k] + to_dest[k]) * FLT_EPSILON);
+            }
+        }
+        return std::max(bound * metric->scale, bound - metric->savings);
+    };
+
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    BinaryHeapQueue& toVisit = landmarkQueue();
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+    if (lowerBound(startID) == std::numeric_limits<double>::infinity()){
+        return path;
+    }
+    toVisit.update(startID, lowerBound(startID));
+    stats.pushed(toVisit.size());
+    workspace.label(startID, 0.0, NO_EDGE, NO_EDGE);
+
+    // dijkstra with every queue key raised by the bound, so the search heads towards the destination
+    while (!toVisit.empty()){
+        int curr = toVisit.pop().node;
+        stats.popped();
+        if (workspace.isSettled(curr)){
+            continue;
+        }
+        workspace.settle(curr);
+        stats.settled();
+
+        if (curr == destID){
+            while (workspace.prevEdge(curr) != NO_EDGE){
+                path.push_back(workspace.prevEdge(curr));
+                curr = workspace.prevNode(curr);
+            }
+            std::reverse(path.begin(), path.end());
+            return path;
+        }
+
+        double currTime = workspace.time(curr);
+        StreetSegmentIdx prevEdge = workspace.prevEdge(curr);
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+            const RoutingEdge& edge = graph.out_edges[e];
+            stats.relaxed();
+            double totalTime = currTime + weights.time(edge.segment);
+            if (prevEdge != NO_EDGE && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]){
+                totalTime += turn_penalty;
+            }
+            if (totalTime < workspace.time(edge.to)){
+                double bound = lowerBound(edge.to);
+                if (bound == std::numeric_limits<double>::infinity()){
+                    continue;
+                }
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime + bound);
+                stats.pushed(toVisit.size());
+            }
+        }
+    }
+    return path;
+}
+
+template std::vector<StreetSegmentIdx> findLandmarkPath<NoSearchStats>(const std::pair<IntersectionIdx, IntersectionIdx>, const double, NoSearchStats&);
+template std::vector<StreetSegmentIdx> findLandmarkPath<CountingSearchStats>(const std::pair<IntersectionIdx, IntersectionIdx>, const double, CountingSearchStats&);
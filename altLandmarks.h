@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include "StreetsDatabaseAPI.h"
+
+// ALT (A*, landmarks, triangle inequality): a few landmark intersections are chosen far apart, and the
+// free-flow travel times from and to every landmark are stored for all intersections. For any intersection
+// v and destination t, d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L), which gives A* a lower
+// bound far tighter than straight-line distance. Nothing depends on the current traffic except two
+// corrections for segments faster than free flow, which each live update adjusts for its changed segments
+// instead of redoing the preprocessing.
+
+// number of landmarks; each costs 2 floats per intersection
+const int ALT_NUM_LANDMARKS = 16;
+
+// picks the landmarks by farthest-point selection on the loaded map and computes their travel times,
+// then starts following traffic updates; call after loadMap
+void buildLandmarks();
+// stops following traffic updates and frees the landmark data (called by closeMap)
+void clearLandmarks();
+
+// the chosen landmark intersections, empty if buildLandmarks has not run
+std::vector<IntersectionIdx> landmarkIntersections();
+
+// Fastest path found by A* with the landmark bound, charging turn penalties the same way dijkstra does.
+// Without a turn penalty its travel time equals findPathBetweenIntersections(intersect_ids, 0)'s; with one,
+// the labels (one per intersection) are settled in another order and may keep a different near-best path.
+// Falls back to plain dijkstra if the landmarks have not been built.
+std::vector<StreetSegmentIdx> findLandmarkPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty);
+// the same query reporting to a statistics policy (see routingFunctions.h)
+template <class Stats>
+std::vector<StreetSegmentIdx> findLandmarkPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, Stats& stats);
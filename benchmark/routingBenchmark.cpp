@@ -0,0 +1,393 @@
+/*
+ * Benchmark suite for the path queries on a real map.
+ * usage: routingBenchmark <path/to/map.streets.bin> [num_queries] [seed] [speed profile file]
+ *        (benchmark/speed_profiles.txt is a sample profile file)
+ *
+ * Query sets (all reproducible from the seed):
+ *   random      num_queries uniformly random (from, to) pairs
+ *   rank 2^r    Dijkstra-rank pairs: for random sources, the 2^r-th intersection a search from the source
+ *               settles, so each set holds queries of one "difficulty" from local to map-wide
+ *
+ * Every engine answers every set and reports mean / p50 / p99 latency, then answers it again with search
+ * statistics on (so counting never shows up in the latencies) and reports the mean settled intersections,
+ * relaxations and peak queue size. Each path is checked against the baseline dijkstra() with the same turn
+ * penalty: it must be drivable from the start to the destination and have the same computePathTravelTime.
+ * Alternative routes are checked the same way for their first route, and every alternative has to be drivable,
+ * report its own travel time and stay within ALTERNATIVE_MAX_STRETCH of the first; their latency is also
+ * given as a multiple of one findPathBetweenIntersections query on the same set.
+ * Time-dependent queries leaving at TIME_DEPENDENT_DEPARTURE are checked by driving their path again segment
+ * by segment: the arrival must be the one the search reports, and with free flow all day the trip must also
+ * take the baseline time. Given a profile file, they run a second time with its profiles.
+ * The exit status is 2 if any answer disagrees.
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "StreetsDatabaseAPI.h"
+#include "m1.h"
+#include "m3.h"
+#include "routingFunctions.h"
+#include "crpOverlay.h"
+#include "altLandmarks.h"
+#include "speedProfiles.h"
+#include "trafficWeights.h"
+
+// turn penalty used by the course's performance tests
+const double BENCHMARK_TURN_PENALTY = 15.0;
+// travel times closer than this (seconds) count as the same answer
+const double TIME_TOLERANCE = 1e-6;
+// smallest Dijkstra rank in the rank query sets is 2^RANK_MIN_LOG
+const int RANK_MIN_LOG = 4;
+// clock time (seconds since midnight) the time-dependent queries leave at: 8:00, in the morning rush
+const double TIME_DEPENDENT_DEPARTURE = 8 * 3600;
+
+typedef std::pair<IntersectionIdx, IntersectionIdx> Query;
+
+struct QuerySet {
+    std::string name;
+    std::vector<Query> queries;
+};
+
+// a way of answering path queries, plain and with search statistics
+struct Engine {
+    std::string name;
+    double turn_penalty;
+    std::function<std::vector<StreetSegmentIdx>(const Query&)> route;
+    std::function<std::vector<StreetSegmentIdx>(const Query&, SearchStats&)> routeWithStats;
+};
+
+struct LatencySummary {
+    double mean;
+    double p50;
+    double p99;
+};
+
+// nearest-rank percentiles of per-query latencies in milliseconds
+static LatencySummary summarize(std::vector<double> latencies){
+    if (latencies.empty()){
+        return {0, 0, 0};
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p){
+        int rank = std::ceil(p * latencies.size()) - 1;
+        return latencies[std::max(rank, 0)];
+    };
+    double sum = 0;
+    for (double latency : latencies){
+        sum += latency;
+    }
+    return {sum / latencies.size(), percentile(0.5), percentile(0.99)};
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// true if the segments can be driven in order from start to destination (an empty path only when start == destination)
+static bool isDrivablePath(const std::vector<StreetSegmentIdx>& path, const Query& query){
+    IntersectionIdx at = query.first;
+    for (StreetSegmentIdx seg : path){
+        StreetSegmentInfo info = getStreetSegmentInfo(seg);
+        if (info.from == at){
+            at = info.to;
+        } else if (info.to == at && !info.oneWay){
+            at = info.from;
+        } else {
+            return false;
+        }
+    }
+    return at == query.second;
+}
+
+static QuerySet randomQueries(int num_queries, std::mt19937& rng){
+    std::uniform_int_distribution<IntersectionIdx> pick(0, getNumIntersections() - 1);
+    QuerySet set = {"random", {}};
+    for (int q = 0; q < num_queries; q++){
+        set.queries.push_back({pick(rng), pick(rng)});
+    }
+    return set;
+}
+
+// one set per rank 2^RANK_MIN_LOG .. up to the number of intersections, num_sources queries each;
+// the settle order comes from an unlimited isochrone search without turn penalties
+static std::vector<QuerySet> rankQueries(int num_sources, std::mt19937& rng){
+    std::uniform_int_distribution<IntersectionIdx> pick(0, getNumIntersections() - 1);
+    std::vector<QuerySet> sets;
+    for (int log = RANK_MIN_LOG; (1 << log) < getNumIntersections(); log++){
+        sets.push_back({"rank 2^" + std::to_string(log), {}});
+    }
+    for (int s = 0; s < num_sources; s++){
+        IntersectionIdx source = pick(rng);
+        std::vector<ReachedIntersection> reached = findIsochrone(source, std::numeric_limits<double>::infinity(), 0).reached;
+        for (int log = RANK_MIN_LOG; log - RANK_MIN_LOG < (int)sets.size(); log++){
+            // sources in small components cannot reach the larger ranks
+            if ((1 << log) < (int)reached.size()){
+                sets[log - RANK_MIN_LOG].queries.push_back({source, reached[1 << log].intersection});
+            }
+        }
+    }
+    return sets;
+}
+
+// the baseline answer: computePathTravelTime of dijkstra()'s path, -1 if there is none
+static std::vector<double> referenceTimes(const QuerySet& set, double turn_penalty){
+    std::vector<double> times;
+    for (const Query& query : set.queries){
+        std::vector<StreetSegmentIdx> path;
+        bool found = dijkstra(query.first, query.second, path, turn_penalty, threadSearchWorkspace());
+        times.push_back(found ? computePathTravelTime(path, turn_penalty) : -1);
+    }
+    return times;
+}
+
+// runs an engine over a set and prints its row; returns the number of wrong answers
+static int runEngine(const Engine& engine, const QuerySet& set, const std::vector<double>& reference){
+    std::vector<double> latencies;
+    int mismatches = 0;
+    for (int q = 0; q < (int)set.queries.size(); q++){
+        const Query& query = set.queries[q];
+        auto start = std::chrono::steady_clock::now();
+        std::vector<StreetSegmentIdx> path = engine.route(query);
+        latencies.push_back(millisecondsSince(start));
+
+        bool found = !path.empty() || query.first == query.second;
+        if (!found){
+            mismatches += (reference[q] != -1);
+        } else if (!isDrivablePath(path, query) || std::abs(computePathTravelTime(path, engine.turn_penalty) - reference[q]) > TIME_TOLERANCE){
+            mismatches++;
+        }
+    }
+
+    double settled = 0, relaxations = 0, peak_queue_size = 0;
+    for (const Query& query : set.queries){
+        SearchStats stats;
+        engine.routeWithStats(query, stats);
+        settled += stats.settled;
+        relaxations += stats.relaxations;
+        peak_queue_size += stats.peak_queue_size;
+    }
+    double num_queries = std::max<size_t>(set.queries.size(), 1);
+
+    LatencySummary summary = summarize(latencies);
+    std::cout << std::setw(14) << set.name << std::setw(22) << engine.name
+              << std::setw(11) << summary.mean << std::setw(11) << summary.p50 << std::setw(11) << summary.p99
+              << std::setw(12) << mismatches << std::setprecision(0) << std::setw(11) << settled / num_queries
+              << std::setw(11) << relaxations / num_queries << std::setw(11) << peak_queue_size / num_queries
+              << std::setprecision(3) << std::endl;
+    return mismatches;
+}
+
+// runs findAlternativeRoutes over a set and prints its row, with the latency relative to one plain query;
+// returns the number of wrong answers
+static int runAlternatives(const QuerySet& set, const std::vector<double>& reference){
+    std::vector<double> latencies;
+    double single_query_ms = 0;
+    int mismatches = 0;
+    for (int q = 0; q < (int)set.queries.size(); q++){
+        const Query& query = set.queries[q];
+        auto start = std::chrono::steady_clock::now();
+        findPathBetweenIntersections(query, BENCHMARK_TURN_PENALTY);
+        single_query_ms += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<AlternativeRoute> routes = findAlternativeRoutes(query, BENCHMARK_TURN_PENALTY);
+        latencies.push_back(millisecondsSince(start));
+
+        if (routes.empty()){
+            mismatches += (reference[q] != -1);
+            continue;
+        }
+        bool correct = std::abs(routes[0].travel_time - reference[q]) <= TIME_TOLERANCE;
+        for (const AlternativeRoute& route : routes){
+            correct = correct && isDrivablePath(route.path, query)
+                && std::abs(computePathTravelTime(route.path, BENCHMARK_TURN_PENALTY) - route.travel_time) <= TIME_TOLERANCE
+                && route.travel_time <= routes[0].travel_time * (1 + ALTERNATIVE_MAX_STRETCH) + TIME_TOLERANCE;
+        }
+        mismatches += !correct;
+    }
+
+    LatencySummary summary = summarize(latencies);
+    double mean_single_query_ms = single_query_ms / std::max<size_t>(set.queries.size(), 1);
+    std::cout << std::setw(14) << set.name << std::setw(22) << "alternatives"
+              << std::setw(11) << summary.mean << std::setw(11) << summary.p50 << std::setw(11) << summary.p99
+              << std::setw(12) << mismatches << std::setw(11) << summary.mean / std::max(mean_single_query_ms, 1e-9)
+              << " x one query" << std::endl;
+    return mismatches;
+}
+
+// when a path driven from the query's start at departure_time arrives, -1 if it is not drivable
+static double timedArrival(const std::vector<StreetSegmentIdx>& path, const Query& query, double departure_time){
+    if (!isDrivablePath(path, query)){
+        return -1;
+    }
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    double clock = departure_time;
+    for (int i = 0; i < (int)path.size(); i++){
+        if (i > 0 && getStreetSegmentInfo(path[i - 1]).streetID != getStreetSegmentInfo(path[i]).streetID){
+            clock += BENCHMARK_TURN_PENALTY;
+        }
+        clock += timeDependentTravelTime(path[i], clock, *weights);
+    }
+    return clock;
+}
+
+// runs the time-dependent query over a set with the loaded profiles and prints its row; returns the number of
+// wrong answers (with free_flow set, trips that do not take the reference time also count)
+static int runTimeDependent(const std::string& name, const QuerySet& set, const std::vector<double>& reference, bool free_flow){
+    std::vector<double> latencies;
+    int mismatches = 0;
+    for (int q = 0; q < (int)set.queries.size(); q++){
+        const Query& query = set.queries[q];
+        auto start = std::chrono::steady_clock::now();
+        TimedPath timed = findTimeDependentPath(query, TIME_DEPENDENT_DEPARTURE, BENCHMARK_TURN_PENALTY);
+        latencies.push_back(millisecondsSince(start));
+
+        if (std::isinf(timed.arrival_time)){
+            mismatches += (reference[q] != -1);
+            continue;
+        }
+        double trip_time = timed.arrival_time - TIME_DEPENDENT_DEPARTURE;
+        if (std::abs(timedArrival(timed.path, query, TIME_DEPENDENT_DEPARTURE) - timed.arrival_time) > TIME_TOLERANCE
+                || (free_flow && std::abs(trip_time - reference[q]) > TIME_TOLERANCE)){
+            mismatches++;
+        }
+    }
+    LatencySummary summary = summarize(latencies);
+    std::cout << std::setw(14) << set.name << std::setw(22) << name
+              << std::setw(11) << summary.mean << std::setw(11) << summary.p50 << std::setw(11) << summary.p99
+              << std::setw(12) << mismatches << std::endl;
+    return mismatches;
+}
+
+// mean latency of computePathTravelTime over the baseline paths of a set
+static void timeTravelTime(const QuerySet& set){
+    std::vector<std::vector<StreetSegmentIdx>> paths;
+    for (const Query& query : set.queries){
+        paths.push_back(findPathBetweenIntersections(query, BENCHMARK_TURN_PENALTY));
+    }
+    std::vector<double> latencies;
+    for (const std::vector<StreetSegmentIdx>& path : paths){
+        auto start = std::chrono::steady_clock::now();
+        computePathTravelTime(path, BENCHMARK_TURN_PENALTY);
+        latencies.push_back(millisecondsSince(start));
+    }
+    LatencySummary summary = summarize(latencies);
+    std::cout << std::setw(14) << set.name << std::setw(22) << "computePathTravelTime"
+              << std::setw(11) << summary.mean << std::setw(11) << summary.p50 << std::setw(11) << summary.p99 << std::endl;
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        std::cerr << "usage: " << argv[0] << " <map.streets.bin> [num_queries] [seed] [speed profile file]" << std::endl;
+        return 1;
+    }
+    int num_queries = (argc > 2) ? std::stoi(argv[2]) : 1000;
+    unsigned seed = (argc > 3) ? std::stoul(argv[3]) : 1;
+    if (!loadMap(argv[1])){
+        std::cerr << "could not load " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << std::fixed << std::setprecision(3);
+
+    // the profiles are swapped in only for their own rows, every other engine runs at free flow
+    SpeedProfileStore profiles;
+    bool has_profiles = false;
+    if (argc > 4){
+        if (!loadSpeedProfiles(argv[4])){
+            closeMap();
+            return 1;
+        }
+        profiles = speed_profiles;
+        has_profiles = true;
+        clearSpeedProfiles();
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<QuerySet> sets = {randomQueries(num_queries, rng)};
+    // a tenth as many sources as random queries, since every source gives one query per rank
+    for (QuerySet& set : rankQueries(std::max(num_queries / 10, 1), rng)){
+        sets.push_back(std::move(set));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    buildLandmarks();
+    std::cout << "landmarks built in " << millisecondsSince(start) << " ms" << std::endl;
+    start = std::chrono::steady_clock::now();
+    buildCrpOverlay();
+    std::cout << "overlay built in " << millisecondsSince(start) << " ms" << std::endl;
+
+    // the overlay has no turn penalties, so it and the engines checked against it run without them
+    std::vector<Engine> engines;
+    const char* queue_names[NUM_ROUTING_QUEUE_TYPES] = {"binary heap", "4-ary heap", "radix heap"};
+    for (int type = 0; type < NUM_ROUTING_QUEUE_TYPES; type++){
+        engines.push_back({queue_names[type], BENCHMARK_TURN_PENALTY, [type](const Query& query){
+            setRoutingQueueType((RoutingQueueType)type);
+            return findPathBetweenIntersections(query, BENCHMARK_TURN_PENALTY);
+        }, [type](const Query& query, SearchStats& stats){
+            setRoutingQueueType((RoutingQueueType)type);
+            return findPathWithStats(query, BENCHMARK_TURN_PENALTY, stats);
+        }});
+    }
+    engines.push_back({"dijkstra, no turns", 0, [](const Query& query){
+        setRoutingQueueType(BINARY_HEAP_QUEUE);
+        return findPathBetweenIntersections(query, 0);
+    }, [](const Query& query, SearchStats& stats){
+        setRoutingQueueType(BINARY_HEAP_QUEUE);
+        return findPathWithStats(query, 0, stats);
+    }});
+    engines.push_back({"landmarks, no turns", 0, [](const Query& query){
+        return findLandmarkPath(query, 0);
+    }, [](const Query& query, SearchStats& stats){
+        CountingSearchStats counting;
+        std::vector<StreetSegmentIdx> path = findLandmarkPath(query, 0, counting);
+        stats = counting.counts;
+        return path;
+    }});
+    engines.push_back({"overlay, no turns", 0, [](const Query& query){
+        return findOverlayPath(query);
+    }, [](const Query& query, SearchStats& stats){
+        CountingSearchStats counting;
+        std::vector<StreetSegmentIdx> path = findOverlayPath(query, counting);
+        stats = counting.counts;
+        return path;
+    }});
+
+    int failures = 0;
+    std::cout << std::setw(14) << "query set" << std::setw(22) << "engine" << std::setw(11) << "mean ms"
+              << std::setw(11) << "p50 ms" << std::setw(11) << "p99 ms" << std::setw(12) << "mismatches"
+              << std::setw(11) << "settled" << std::setw(11) << "relaxed" << std::setw(11) << "peak queue" << std::endl;
+    for (const QuerySet& set : sets){
+        setRoutingQueueType(BINARY_HEAP_QUEUE);
+        std::vector<double> with_turns = referenceTimes(set, BENCHMARK_TURN_PENALTY);
+        std::vector<double> without_turns = referenceTimes(set, 0);
+        for (const Engine& engine : engines){
+            failures += runEngine(engine, set, engine.turn_penalty == 0 ? without_turns : with_turns);
+        }
+        setRoutingQueueType(BINARY_HEAP_QUEUE);
+        timeTravelTime(set);
+        failures += runAlternatives(set, with_turns);
+        failures += runTimeDependent("time-dependent, free", set, with_turns, true);
+        if (has_profiles){
+            speed_profiles = profiles;
+            failures += runTimeDependent("time-dependent, 8:00", set, with_turns, false);
+            clearSpeedProfiles();
+        }
+
+        // the batch query on the worker pool only has a throughput
+        start = std::chrono::steady_clock::now();
+        findPathsBetweenIntersections(set.queries, BENCHMARK_TURN_PENALTY);
+        std::cout << std::setw(14) << set.name << std::setw(22) << "batch"
+                  << std::setw(11) << millisecondsSince(start) / std::max<size_t>(set.queries.size(), 1) << std::endl;
+    }
+
+    closeMap();
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,145 @@
+/*
+ * Checks live traffic updates on a real map.
+ * usage: trafficReplayCheck <path/to/map.streets.bin> <traffic log> [num_queries] [seed]
+ *        (benchmark/traffic_replay.txt replays on any map)
+ *
+ * Builds the landmarks and the overlay, replays the log with replayTrafficFile and then checks that
+ *   - every segment's time in the published snapshot is its free-flow time, or its length over the speed of
+ *     the last update to it in the log
+ *   - the overlay and landmark queries, kept current by their weight listeners, give the same travel times
+ *     as dijkstra on the new snapshot, and as an overlay and landmarks rebuilt from scratch after the replay
+ * Queries start or end at the updated segments (so they are likely to use them) and the rest are random.
+ * The exit status is 2 if anything disagrees.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+
+#include "StreetsDatabaseAPI.h"
+#include "m1.h"
+#include "routingFunctions.h"
+#include "trafficWeights.h"
+#include "crpOverlay.h"
+#include "altLandmarks.h"
+
+// travel times closer than this (seconds) count as the same
+const double TIME_TOLERANCE = 1e-6;
+
+typedef std::pair<IntersectionIdx, IntersectionIdx> Query;
+
+// the last speed the log gives each segment, read independently of replayTrafficFile
+static bool lastSpeeds(const std::string& traffic_path, std::unordered_map<StreetSegmentIdx, double>& speeds){
+    std::ifstream file(traffic_path);
+    std::string line;
+    while (std::getline(file, line)){
+        std::istringstream fields(line);
+        double timestamp, speed;
+        StreetSegmentIdx segment;
+        if (line.empty() || line[0] == '#'){
+            continue;
+        }
+        if (fields >> timestamp >> segment >> speed){
+            speeds[segment] = speed;
+        }
+    }
+    return (bool)file.eof();
+}
+
+// returns the number of segments whose snapshot time is not the expected one
+static int checkSnapshot(const std::unordered_map<StreetSegmentIdx, double>& speeds){
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    int mismatches = 0;
+    for (StreetSegmentIdx seg = 0; seg < getNumStreetSegments(); seg++){
+        auto updated = speeds.find(seg);
+        double expected = updated == speeds.end() ? findStreetSegmentTravelTime(seg) : findStreetSegmentLength(seg) / updated->second;
+        if (std::abs(weights->time(seg) - expected) > TIME_TOLERANCE){
+            std::cout << "segment " << seg << ": snapshot time " << weights->time(seg) << ", expected " << expected << std::endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// the travel time of a path on the current snapshot, -1 if there is none
+static double liveTime(const std::vector<StreetSegmentIdx>& path, const Query& query){
+    if (path.empty() && query.first != query.second){
+        return -1;
+    }
+    return computePathTravelTime(path, 0, *currentWeights());
+}
+
+// compares the overlay and landmark answers against dijkstra's; returns the number of disagreements
+static int checkQueries(const std::vector<Query>& queries, const std::string& label){
+    int mismatches = 0;
+    for (const Query& query : queries){
+        std::vector<StreetSegmentIdx> path;
+        dijkstra(query.first, query.second, path, 0, threadSearchWorkspace());
+        double reference = liveTime(path, query);
+        double overlay = liveTime(findOverlayPath(query), query);
+        double landmarks = liveTime(findLandmarkPath(query, 0), query);
+        if (std::abs(overlay - reference) > TIME_TOLERANCE || std::abs(landmarks - reference) > TIME_TOLERANCE){
+            std::cout << label << " " << query.first << " -> " << query.second << ": dijkstra " << reference
+                      << " s, overlay " << overlay << " s, landmarks " << landmarks << " s" << std::endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){
+        std::cerr << "usage: " << argv[0] << " <map.streets.bin> <traffic log> [num_queries] [seed]" << std::endl;
+        return 1;
+    }
+    std::string traffic_path = argv[2];
+    int num_queries = (argc > 3) ? std::stoi(argv[3]) : 200;
+    unsigned seed = (argc > 4) ? std::stoul(argv[4]) : 1;
+    if (!loadMap(argv[1])){
+        std::cerr << "could not load " << argv[1] << std::endl;
+        return 1;
+    }
+    std::unordered_map<StreetSegmentIdx, double> speeds;
+    if (!lastSpeeds(traffic_path, speeds)){
+        std::cerr << "could not read " << traffic_path << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<IntersectionIdx> pick(0, getNumIntersections() - 1);
+    std::vector<Query> queries;
+    for (const auto& [seg, speed] : speeds){
+        StreetSegmentInfo info = getStreetSegmentInfo(seg);
+        queries.push_back({info.from, pick(rng)});
+        queries.push_back({pick(rng), info.to});
+    }
+    for (int q = 0; q < num_queries; q++){
+        queries.push_back({pick(rng), pick(rng)});
+    }
+
+    buildLandmarks();
+    buildCrpOverlay();
+    int batches = replayTrafficFile(traffic_path);
+    if (batches < 0){
+        closeMap();
+        return 2;
+    }
+    std::cout << "replayed " << batches << " batches updating " << speeds.size() << " segments" << std::endl;
+
+    int failures = checkSnapshot(speeds);
+    failures += checkQueries(queries, "incremental");
+    // structures built from the final snapshot have to agree with the ones that followed the updates
+    clearCrpOverlay();
+    clearLandmarks();
+    buildLandmarks();
+    buildCrpOverlay();
+    failures += checkQueries(queries, "rebuilt");
+
+    std::cout << queries.size() << " queries, " << failures << " mismatches" << std::endl;
+    closeMap();
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,544 @@
+#include <vector>
+#include <queue>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+
+#include "StreetsDatabaseAPI.h"
+#include "m1.h"
+#include "m3.h"
+#include "m4.h"
+#include "courierFunctions.h"
+#include "routingGraph.h"
+#include "routingFunctions.h"
+#include "trafficWeights.h"
+
+// number of annealing iterations between clock checks and temperature updates
+const int ANNEAL_CHECK_INTERVAL = 1024;
+// number of random moves sampled to pick the starting temperature
+const int ANNEAL_TEMPERATURE_SAMPLES = 200;
+// the temperature decays geometrically from the sampled value down to this fraction of it
+const double ANNEAL_FINAL_TEMPERATURE_RATIO = 1e-4;
+
+
+/********************************************************************************/
+/*******************************Travel Time Matrix*******************************/
+/********************************************************************************/
+
+std::vector<double> multiDestinationTimes(IntersectionIdx src, const std::vector<IntersectionIdx>& targets, double turn_penalty){
+    const RoutingGraph& graph = routing_graph;
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    workspace.reset();
+    // (time, intersection) pairs ordered so the smallest time is on top
+    std::priority_queue<std::pair<double, IntersectionIdx>, std::vector<std::pair<double, IntersectionIdx>>, std::greater<std::pair<double, IntersectionIdx>>> toVisit;
+
+    // count the distinct targets so the search can stop once all of them are settled
+    std::unordered_set<IntersectionIdx> target_set(targets.begin(), targets.end());
+    int targets_left = target_set.size();
+
+    toVisit.push({0.0, src});
+    workspace.label(src, 0.0, -1, -1);
+    while (!toVisit.empty() && targets_left > 0){
+        auto [currTime, currID] = toVisit.top();
+        toVisit.pop();
+        if (workspace.isSettled(currID)){
+            continue;
+        }
+        workspace.settle(currID);
+        if (target_set.count(currID)){
+            targets_left--;
+        }
+
+        // relax the outgoing edges the same way findPathBetweenIntersections does so the times agree
+        StreetSegmentIdx prevEdge = workspace.prevEdge(currID);
+        for (int e = graph.first_out[currID]; e < graph.first_out[currID + 1]; e++){
+            const RoutingEdge& edge = graph.out_edges[e];
+            double totalTime = currTime + weights->time(edge.segment);
+            if (prevEdge != -1 && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]){
+                totalTime += turn_penalty;
+            }
+            if (totalTime < workspace.time(edge.to)){
+                workspace.label(edge.to, totalTime, edge.segment, currID);
+                toVisit.push({totalTime, edge.to});
+            }
+        }
+    }
+
+    std::vector<double> times;
+    times.reserve(targets.size());
+    for (IntersectionIdx target : targets){
+        times.push_back(workspace.isSettled(target) ? workspace.time(target) : std::numeric_limits<double>::infinity());
+    }
+    return times;
+}
+
+std::vector<NearestDepot> nearestDepotTimes(const std::vector<IntersectionIdx>& depots, const std::vector<IntersectionIdx>& targets, double turn_penalty, bool towards_depot){
+    const RoutingGraph& graph = routing_graph;
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    workspace.reset();
+    std::priority_queue<std::pair<double, IntersectionIdx>, std::vector<std::pair<double, IntersectionIdx>>, std::greater<std::pair<double, IntersectionIdx>>> toVisit;
+    // searching towards the depots walks the reversed graph, i.e. the segments that lead into each intersection
+    const std::vector<int>& first_edge = towards_depot ? graph.first_in : graph.first_out;
+    const std::vector<RoutingEdge>& edges = towards_depot ? graph.in_edges : graph.out_edges;
+
+    std::unordered_set<IntersectionIdx> target_set(targets.begin(), targets.end());
+    int targets_left = target_set.size();
+
+    // every depot starts at time zero, so each intersection is labelled by its closest depot
+    for (IntersectionIdx depot : depots){
+        if (workspace.time(depot) > 0){
+            workspace.label(depot, 0.0, -1, -1, depot);
+            toVisit.push({0.0, depot});
+        }
+    }
+
+    while (!toVisit.empty() && targets_left > 0){
+        auto [currTime, currID] = toVisit.top();
+        toVisit.pop();
+        if (workspace.isSettled(currID)){
+            continue;
+        }
+        workspace.settle(currID);
+        if (target_set.count(currID)){
+            targets_left--;
+        }
+
+        StreetSegmentIdx prevEdge = workspace.prevEdge(currID);
+        IntersectionIdx origin = workspace.source(currID);
+        for (int e = first_edge[currID]; e < first_edge[currID + 1]; e++){
+            const RoutingEdge& edge = edges[e];
+            double totalTime = currTime + weights->time(edge.segment);
+            if (prevEdge != -1 && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]){
+                totalTime += turn_penalty;
+            }
+            if (totalTime < workspace.time(edge.to)){
+                workspace.label(edge.to, totalTime, edge.segment, currID, origin);
+                toVisit.push({totalTime, edge.to});
+            }
+        }
+    }
+
+    std::vector<NearestDepot> nearest;
+    nearest.reserve(targets.size());
+    for (IntersectionIdx target : targets){
+        if (workspace.isSettled(target)){
+            nearest.push_back({workspace.time(target), workspace.source(target)});
+        } else {
+            nearest.push_back({std::numeric_limits<double>::infinity(), depots[0]});
+        }
+    }
+    return nearest;
+}
+
+// replaces unreachable times by the finite penalty the move engine works with
+static double capTime(double time){
+    return std::isinf(time) ? UNREACHABLE_PENALTY : time;
+}
+
+CourierMatrix buildCourierMatrix(const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots, double turn_penalty){
+    CourierMatrix matrix;
+    for (int d = 0; d < (int)deliveries.size(); d++){
+        matrix.stops.push_back({deliveries[d].pickUp, d, true});
+        matrix.stops.push_back({deliveries[d].dropOff, d, false});
+    }
+    int num_stops = matrix.stops.size();
+
+    // several stops can share an intersection, so only search once from each distinct one
+    std::vector<IntersectionIdx> unique_stops;
+    std::unordered_map<IntersectionIdx, int> unique_index;
+    std::vector<int> stop_unique(num_stops);
+    for (int s = 0; s < num_stops; s++){
+        IntersectionIdx inter = matrix.stops[s].intersection;
+        auto found = unique_index.find(inter);
+        if (found == unique_index.end()){
+            found = unique_index.emplace(inter, unique_stops.size()).first;
+            unique_stops.push_back(inter);
+        }
+        stop_unique[s] = found->second;
+    }
+    int num_unique = unique_stops.size();
+
+    // one search per distinct stop gives a row of travel times to the other stops
+    std::vector<std::vector<double>> unique_rows(num_unique);
+    for (int u = 0; u < num_unique; u++){
+        unique_rows[u] = multiDestinationTimes(unique_stops[u], unique_stops, turn_penalty);
+    }
+    matrix.stop_to_stop.assign(num_stops, std::vector<double>(num_stops, 0));
+    for (int a = 0; a < num_stops; a++){
+        const std::vector<double>& row = unique_rows[stop_unique[a]];
+        for (int b = 0; b < num_stops; b++){
+            matrix.stop_to_stop[a][b] = capTime(row[stop_unique[b]]);
+        }
+    }
+
+    // two multi-source searches give the best start and end depot of every stop, however many depots there are
+    std::vector<NearestDepot> start_depots = nearestDepotTimes(depots, unique_stops, turn_penalty, false);
+    std::vector<NearestDepot> end_depots = nearestDepotTimes(depots, unique_stops, turn_penalty, true);
+    matrix.from_depot.resize(num_stops);
+    matrix.best_start_depot.resize(num_stops);
+    matrix.to_depot.resize(num_stops);
+    matrix.best_end_depot.resize(num_stops);
+    for (int s = 0; s < num_stops; s++){
+        const NearestDepot& start = start_depots[stop_unique[s]];
+        const NearestDepot& end = end_depots[stop_unique[s]];
+        matrix.from_depot[s] = capTime(start.time);
+        matrix.best_start_depot[s] = start.depot;
+        matrix.to_depot[s] = capTime(end.time);
+        matrix.best_end_depot[s] = end.depot;
+    }
+    return matrix;
+}
+
+std::vector<int> greedyCourierTour(const CourierMatrix& matrix){
+    int num_stops = matrix.stops.size();
+    std::vector<bool> visited(num_stops, false);
+    std::vector<int> tour;
+    tour.reserve(num_stops);
+
+    int curr = DEPOT_STOP;
+    while ((int)tour.size() < num_stops){
+        int best_stop = DEPOT_STOP;
+        double best_time = std::numeric_limits<double>::infinity();
+        for (int s = 0; s < num_stops; s++){
+            // a drop-off is only allowed once its pickup has been visited
+            if (visited[s] || (!matrix.stops[s].is_pickup && !visited[s ^ 1])){
+                continue;
+            }
+            double time = (curr == DEPOT_STOP) ? matrix.from_depot[s] : matrix.stop_to_stop[curr][s];
+            if (time < best_time){
+                best_time = time;
+                best_stop = s;
+            }
+        }
+        visited[best_stop] = true;
+        tour.push_back(best_stop);
+        curr = best_stop;
+    }
+    return tour;
+}
+
+
+/********************************************************************************/
+/*********************************Move Engine************************************/
+/********************************************************************************/
+
+CourierMoveEngine::CourierMoveEngine(const CourierMatrix& matrix, std::vector<int> initial_tour)
+    : times(matrix), num_stops(initial_tour.size()), order(std::move(initial_tour)) {
+    position.resize(num_stops);
+    forward_prefix.resize(num_stops);
+    backward_prefix.resize(num_stops);
+    closing_pos.resize(num_stops + 1);
+    refresh();
+}
+
+void CourierMoveEngine::resetTour(std::vector<int> new_tour){
+    order = std::move(new_tour);
+    refresh();
+}
+
+double CourierMoveEngine::edge(int from_stop, int to_stop) const {
+    if (from_stop == DEPOT_STOP){
+        return (to_stop == DEPOT_STOP) ? 0 : times.from_depot[to_stop];
+    }
+    if (to_stop == DEPOT_STOP){
+        return times.to_depot[from_stop];
+    }
+    return times.stop_to_stop[from_stop][to_stop];
+}
+
+int CourierMoveEngine::stopAt(int pos) const {
+    if (pos < 0 || pos >= num_stops){
+        return DEPOT_STOP;
+    }
+    return order[pos];
+}
+
+int CourierMoveEngine::reducedStopAt(int slot, int pickup_pos, int dropoff_pos) const {
+    if (slot < 0 || slot >= num_stops - 2){
+        return DEPOT_STOP;
+    }
+    // skip over the two removed positions (pickup_pos < dropoff_pos)
+    int pos = slot + (slot >= pickup_pos ? 1 : 0);
+    pos += (pos >= dropoff_pos ? 1 : 0);
+    return order[pos];
+}
+
+void CourierMoveEngine::refresh(){
+    tour_cost = edge(DEPOT_STOP, stopAt(0)) + edge(stopAt(num_stops - 1), DEPOT_STOP);
+    for (int pos = 0; pos < num_stops; pos++){
+        position[order[pos]] = pos;
+    }
+    // prefix sums of the edges walked forwards and backwards so any reversed stretch costs O(1)
+    forward_prefix[0] = 0;
+    backward_prefix[0] = 0;
+    for (int pos = 1; pos < num_stops; pos++){
+        forward_prefix[pos] = forward_prefix[pos - 1] + edge(order[pos - 1], order[pos]);
+        backward_prefix[pos] = backward_prefix[pos - 1] + edge(order[pos], order[pos - 1]);
+    }
+    tour_cost += forward_prefix[num_stops - 1];
+    // a stretch can only be reversed if no delivery has both its pickup and drop-off inside it
+    closing_pos[num_stops] = num_stops;
+    for (int pos = num_stops - 1; pos >= 0; pos--){
+        int stop = order[pos];
+        closing_pos[pos] = closing_pos[pos + 1];
+        if (times.stops[stop].is_pickup){
+            closing_pos[pos] = std::min(closing_pos[pos], partnerPos(stop));
+        }
+    }
+}
+
+bool CourierMoveEngine::proposeRelocate(int from_pos, int to_pos, double& delta) const {
+    if (from_pos == to_pos){
+        return false;
+    }
+    int stop = order[from_pos];
+    bool is_pickup = times.stops[stop].is_pickup;
+    int partner = partnerPos(stop);
+    int before, after;
+    if (to_pos < from_pos){
+        // the stop lands just before the stop currently at to_pos; only a drop-off moving earlier can break precedence
+        if (!is_pickup && partner >= to_pos){
+            return false;
+        }
+        before = stopAt(to_pos - 1);
+        after = stopAt(to_pos);
+    } else {
+        // the stop lands just after the stop currently at to_pos; only a pickup moving later can break precedence
+        if (is_pickup && partner <= to_pos){
+            return false;
+        }
+        before = stopAt(to_pos);
+        after = stopAt(to_pos + 1);
+    }
+    int prev = stopAt(from_pos - 1);
+    int next = stopAt(from_pos + 1);
+    delta = edge(prev, next) - edge(prev, stop) - edge(stop, next)
+          + edge(before, stop) + edge(stop, after) - edge(before, after);
+    return true;
+}
+
+void CourierMoveEngine::applyRelocate(int from_pos, int to_pos){
+    if (to_pos < from_pos){
+        std::rotate(order.begin() + to_pos, order.begin() + from_pos, order.begin() + from_pos + 1);
+    } else {
+        std::rotate(order.begin() + from_pos, order.begin() + from_pos + 1, order.begin() + to_pos + 1);
+    }
+    refresh();
+}
+
+bool CourierMoveEngine::proposeSwap(int pos_a, int pos_b, double& delta) const {
+    if (pos_a == pos_b){
+        return false;
+    }
+    if (pos_a > pos_b){
+        std::swap(pos_a, pos_b);
+    }
+    int first = order[pos_a];
+    int second = order[pos_b];
+    // the earlier stop moves later, the later stop moves earlier
+    if (times.stops[first].is_pickup && partnerPos(first) <= pos_b){
+        return false;
+    }
+    if (!times.stops[second].is_pickup && partnerPos(second) >= pos_a){
+        return false;
+    }
+    int prev = stopAt(pos_a - 1);
+    int next = stopAt(pos_b + 1);
+    if (pos_b == pos_a + 1){
+        delta = edge(prev, second) + edge(second, first) + edge(first, next)
+              - edge(prev, first) - edge(first, second) - edge(second, next);
+    } else {
+        int after_first = stopAt(pos_a + 1);
+        int before_second = stopAt(pos_b - 1);
+        delta = edge(prev, second) + edge(second, after_first) + edge(before_second, first) + edge(first, next)
+              - edge(prev, first) - edge(first, after_first) - edge(before_second, second) - edge(second, next);
+    }
+    return true;
+}
+
+void CourierMoveEngine::applySwap(int pos_a, int pos_b){
+    std::swap(order[pos_a], order[pos_b]);
+    refresh();
+}
+
+bool CourierMoveEngine::proposeTwoOpt(int first, int last, double& delta) const {
+    if (first > last){
+        std::swap(first, last);
+    }
+    if (first == last || closing_pos[first] <= last){
+        return false;
+    }
+    int prev = stopAt(first - 1);
+    int next = stopAt(last + 1);
+    double inner_forward = forward_prefix[last] - forward_prefix[first];
+    double inner_backward = backward_prefix[last] - backward_prefix[first];
+    delta = edge(prev, order[last]) + inner_backward + edge(order[first], next)
+          - edge(prev, order[first]) - inner_forward - edge(order[last], next);
+    return true;
+}
+
+void CourierMoveEngine::applyTwoOpt(int first, int last){
+    if (first > last){
+        std::swap(first, last);
+    }
+    std::reverse(order.begin() + first, order.begin() + last + 1);
+    refresh();
+}
+
+bool CourierMoveEngine::proposePairRelocate(int delivery, int pickup_slot, int dropoff_slot, double& delta) const {
+    if (num_stops < 4 || pickup_slot > dropoff_slot){
+        return false;
+    }
+    int pickup = 2 * delivery;
+    int dropoff = pickup + 1;
+    int pickup_pos = position[pickup];
+    int dropoff_pos = position[dropoff];
+
+    // cost of taking both stops out of the tour
+    int prev = stopAt(pickup_pos - 1);
+    int next = stopAt(dropoff_pos + 1);
+    if (dropoff_pos == pickup_pos + 1){
+        delta = edge(prev, next) - edge(prev, pickup) - edge(pickup, dropoff) - edge(dropoff, next);
+    } else {
+        int after_pickup = stopAt(pickup_pos + 1);
+        int before_dropoff = stopAt(dropoff_pos - 1);
+        delta = edge(prev, after_pickup) - edge(prev, pickup) - edge(pickup, after_pickup)
+              + edge(before_dropoff, next) - edge(before_dropoff, dropoff) - edge(dropoff, next);
+    }
+
+    // cost of putting them back into the shortened tour
+    int pickup_before = reducedStopAt(pickup_slot - 1, pickup_pos, dropoff_pos);
+    int pickup_after = reducedStopAt(pickup_slot, pickup_pos, dropoff_pos);
+    if (pickup_slot == dropoff_slot){
+        delta += edge(pickup_before, pickup) + edge(pickup, dropoff) + edge(dropoff, pickup_after)
+               - edge(pickup_before, pickup_after);
+    } else {
+        int dropoff_before = reducedStopAt(dropoff_slot - 1, pickup_pos, dropoff_pos);
+        int dropoff_after = reducedStopAt(dropoff_slot, pickup_pos, dropoff_pos);
+        delta += edge(pickup_before, pickup) + edge(pickup, pickup_after) - edge(pickup_before, pickup_after)
+               + edge(dropoff_before, dropoff) + edge(dropoff, dropoff_after) - edge(dropoff_before, dropoff_after);
+    }
+    return true;
+}
+
+void CourierMoveEngine::applyPairRelocate(int delivery, int pickup_slot, int dropoff_slot){
+    int pickup = 2 * delivery;
+    int dropoff = pickup + 1;
+    std::vector<int> reduced;
+    reduced.reserve(num_stops);
+    for (int stop : order){
+        if (stop != pickup && stop != dropoff){
+            reduced.push_back(stop);
+        }
+    }
+    // insert the drop-off first so the pickup slot still refers to the same place
+    reduced.insert(reduced.begin() + dropoff_slot, dropoff);
+    reduced.insert(reduced.begin() + pickup_slot, pickup);
+    order = std::move(reduced);
+    refresh();
+}
+
+
+/********************************************************************************/
+/******************************Simulated Annealing*******************************/
+/********************************************************************************/
+
+// the kinds of move the annealer draws from
+enum CourierMoveType { RELOCATE, SWAP, TWO_OPT, PAIR_RELOCATE, NUM_MOVE_TYPES };
+
+// draws a random move, returning false if it is a no-op or breaks precedence
+static bool proposeRandomMove(const CourierMoveEngine& engine, std::mt19937& rng, int move[4], double& delta){
+    int num_stops = engine.size();
+    std::uniform_int_distribution<int> pick_pos(0, num_stops - 1);
+    move[0] = std::uniform_int_distribution<int>(0, NUM_MOVE_TYPES - 1)(rng);
+    move[1] = pick_pos(rng);
+    move[2] = pick_pos(rng);
+    switch (move[0]){
+        case RELOCATE:
+            return engine.proposeRelocate(move[1], move[2], delta);
+        case SWAP:
+            return engine.proposeSwap(move[1], move[2], delta);
+        case TWO_OPT:
+            return engine.proposeTwoOpt(move[1], move[2], delta);
+        default: {
+            // slots index the tour with the delivery removed, so there are num_stops - 1 of them
+            std::uniform_int_distribution<int> pick_slot(0, num_stops - 2);
+            int first = pick_slot(rng);
+            int second = pick_slot(rng);
+            move[1] = std::uniform_int_distribution<int>(0, num_stops / 2 - 1)(rng);
+            move[2] = std::min(first, second);
+            move[3] = std::max(first, second);
+            return engine.proposePairRelocate(move[1], move[2], move[3], delta);
+        }
+    }
+}
+
+static void applyMove(CourierMoveEngine& engine, const int move[4]){
+    switch (move[0]){
+        case RELOCATE:
+            engine.applyRelocate(move[1], move[2]);
+            break;
+        case SWAP:
+            engine.applySwap(move[1], move[2]);
+            break;
+        case TWO_OPT:
+            engine.applyTwoOpt(move[1], move[2]);
+            break;
+        default:
+            engine.applyPairRelocate(move[1], move[2], move[3]);
+            break;
+    }
+}
+
+void annealCourierTour(CourierMoveEngine& engine, std::chrono::steady_clock::time_point deadline, std::mt19937& rng){
+    if (engine.size() < 3){
+        return;
+    }
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int move[4];
+    double delta;
+
+    // start hot enough that a typical uphill move is accepted about a third of the time
+    double total_delta = 0;
+    int samples = 0;
+    for (int i = 0; i < ANNEAL_TEMPERATURE_SAMPLES; i++){
+        if (proposeRandomMove(engine, rng, move, delta) && delta < UNREACHABLE_PENALTY){
+            total_delta += std::abs(delta);
+            samples++;
+        }
+    }
+    double start_temperature = (samples > 0 && total_delta > 0) ? total_delta / samples : 1.0;
+    double temperature = start_temperature;
+
+    auto start = std::chrono::steady_clock::now();
+    double budget = std::chrono::duration<double>(deadline - start).count();
+    std::vector<int> best_tour = engine.tour();
+    double best_cost = engine.cost();
+
+    for (long iteration = 0; ; iteration++){
+        if (iteration % ANNEAL_CHECK_INTERVAL == 0){
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed >= budget){
+                break;
+            }
+            temperature = start_temperature * std::pow(ANNEAL_FINAL_TEMPERATURE_RATIO, elapsed / budget);
+        }
+        if (!proposeRandomMove(engine, rng, move, delta)){
+            continue;
+        }
+        if (delta < 0 || unit(rng) < std::exp(-delta / temperature)){
+            applyMove(engine, move);
+            if (engine.cost() < best_cost){
+                best_cost = engine.cost();
+                best_tour = engine.tour();
+            }
+        }
+    }
+
+    // finish on the best tour seen rather than wherever the walk ended up
+    engine.resetTour(best_tour);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include "StreetsDatabaseAPI.h"
+#include "m4.h"
+
+// wall-clock second (measured from the start of travelingCourier) at which the annealer stops,
+// leaving headroom under the 50 s limit for building the street segment subpaths
+const double COURIER_ANNEAL_DEADLINE = 40.0;
+// large finite cost used for stop pairs that cannot reach each other so delta arithmetic never sees inf - inf
+const double UNREACHABLE_PENALTY = 1e9;
+// stop index used for the depot at either end of the tour
+const int DEPOT_STOP = -1;
+
+// a pickup or drop-off the courier must visit
+// stop 2*d is the pickup of delivery d and stop 2*d+1 is its drop-off
+struct CourierStop {
+    IntersectionIdx intersection;
+    int delivery;
+    bool is_pickup;
+};
+
+// the depot closest (by travel time) to or from an intersection
+struct NearestDepot {
+    double time;
+    IntersectionIdx depot;
+};
+
+// every travel time the move engine needs, so that evaluating a move is matrix lookups only
+struct CourierMatrix {
+    std::vector<CourierStop> stops;
+    // stop_to_stop[a][b] is the travel time from stop a to stop b
+    std::vector<std::vector<double>> stop_to_stop;
+    // travel time from the closest start depot to each stop and which depot that is
+    std::vector<double> from_depot;
+    std::vector<IntersectionIdx> best_start_depot;
+    // travel time from each stop to the closest end depot and which depot that is
+    std::vector<double> to_depot;
+    std::vector<IntersectionIdx> best_end_depot;
+};
+
+// Holds a courier tour and evaluates relocate, swap, 2-opt and pickup/drop-off pair relocation moves
+// incrementally. Every propose function is O(1): deltas come from matrix lookups plus prefix sums of the
+// tour's forward and backward edge costs, and precedence is checked against the position of each stop.
+// Only accepted moves pay O(stops) to rebuild that bookkeeping.
+class CourierMoveEngine {
+public:
+    CourierMoveEngine(const CourierMatrix& matrix, std::vector<int> initial_tour);
+
+    // total travel time of the current tour including both depot legs
+    double cost() const { return tour_cost; }
+    // stop ids in visiting order
+    const std::vector<int>& tour() const { return order; }
+    int size() const { return num_stops; }
+    // replaces the tour with another ordering of the same stops
+    void resetTour(std::vector<int> new_tour);
+
+    // moves the stop at from_pos so that it ends up at to_pos
+    bool proposeRelocate(int from_pos, int to_pos, double& delta) const;
+    void applyRelocate(int from_pos, int to_pos);
+    // exchanges the stops at two positions
+    bool proposeSwap(int pos_a, int pos_b, double& delta) const;
+    void applySwap(int pos_a, int pos_b);
+    // reverses the tour between first and last (inclusive)
+    bool proposeTwoOpt(int first, int last, double& delta) const;
+    void applyTwoOpt(int first, int last);
+    // takes a delivery's pickup and drop-off out of the tour and reinserts them before the stops at
+    // pickup_slot and dropoff_slot of the shortened tour (pickup_slot <= dropoff_slot)
+    bool proposePairRelocate(int delivery, int pickup_slot, int dropoff_slot, double& delta) const;
+    void applyPairRelocate(int delivery, int pickup_slot, int dropoff_slot);
+
+private:
+    // travel time between two stops where DEPOT_STOP stands for the depot at the start or end
+    double edge(int from_stop, int to_stop) const;
+    // stop at a tour position, or DEPOT_STOP past either end
+    int stopAt(int pos) const;
+    // stop at a position of the tour with the given delivery removed
+    int reducedStopAt(int slot, int pickup_pos, int dropoff_pos) const;
+    // position of the partner stop (pickup <-> drop-off) of a stop
+    int partnerPos(int stop) const { return position[stop ^ 1]; }
+    // recomputes positions, prefix sums and precedence closures after a move is applied
+    void refresh();
+
+    const CourierMatrix& times;
+    int num_stops;
+    std::vector<int> order;
+    std::vector<int> position;
+    // forward_prefix[k] sums edge(order[m-1], order[m]) for 0 < m <= k; backward_prefix the reversed edges
+    std::vector<double> forward_prefix;
+    std::vector<double> backward_prefix;
+    // closing_pos[k] is the smallest drop-off position among pickups at positions >= k
+    std::vector<int> closing_pos;
+    double tour_cost = 0;
+};
+
+// runs dijkstra from src until every target is settled and returns the travel time to each target
+std::vector<double> multiDestinationTimes(IntersectionIdx src, const std::vector<IntersectionIdx>& targets, double turn_penalty);
+// finds the closest depot for every target with one search seeded from all depots at once
+// towards_depot = false searches forwards (depot -> target), true searches the reversed graph (target -> depot)
+std::vector<NearestDepot> nearestDepotTimes(const std::vector<IntersectionIdx>& depots, const std::vector<IntersectionIdx>& targets, double turn_penalty, bool towards_depot);
+// computes all the stop-to-stop and depot travel times for a set of deliveries
+CourierMatrix buildCourierMatrix(const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots, double turn_penalty);
+// builds a precedence-feasible tour by always driving to the closest stop that is allowed next
+std::vector<int> greedyCourierTour(const CourierMatrix& matrix);
+// improves the tour with simulated annealing over the engine's moves until the deadline passes
+void annealCourierTour(CourierMoveEngine& engine, std::chrono::steady_clock::time_point deadline, std::mt19937& rng);
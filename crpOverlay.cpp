@@ -0,0 +1,449 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "StreetsDatabaseAPI.h"
+#include "routingGraph.h"
+#include "routingFunctions.h"
+#include "routingQueues.h"
+#include "trafficWeights.h"
+#include "threadPool.h"
+#include "crpOverlay.h"
+
+// a search label reached through a clique stores CLIQUE_ARC - level instead of a segment id
+const int CLIQUE_ARC = -2;
+
+// one level of the partition
+struct CrpLevel {
+    // cell of every intersection
+    std::vector<int> cell_of;
+    // per cell, the intersections with a segment to or from another cell
+    std::vector<std::vector<IntersectionIdx>> boundary;
+    // per intersection, its position in its cell's boundary list, -1 if it is not on the boundary
+    std::vector<int> boundary_index;
+};
+
+// the customized cliques together with the travel times they were computed from
+struct CrpMetric {
+    std::shared_ptr<const WeightSnapshot> weights;
+    // cliques[level][cell] is a row-major boundary x boundary matrix of travel times inside the cell,
+    // infinity where one boundary intersection cannot reach the other without leaving the cell
+    std::vector<std::vector<std::shared_ptr<const std::vector<double>>>> cliques;
+};
+
+// the partition only changes when a map is loaded, so queries read it without synchronization
+static std::vector<CrpLevel> crp_levels;
+// the published metric, only accessed through the std::atomic_load/atomic_store overloads
+static std::shared_ptr<const CrpMetric> crp_metric;
+// serializes building and re-customizing the metric
+static std::mutex customize_lock;
+static int crp_listener = -1;
+
+// every overlay search on a thread shares one queue
+static BinaryHeapQueue& overlayQueue(){
+    thread_local BinaryHeapQueue queue;
+    return queue;
+}
+
+
+/********************************************************************************/
+/**********************************Partition*************************************/
+/********************************************************************************/
+
+typedef std::vector<IntersectionIdx>::iterator NodeIter;
+
+// splits [first, last) at the median of its wider side until no piece has more than max_size intersections
+static void bisect(NodeIter first, NodeIter last, int max_size, const std::vector<std::pair<double, double>>& xy, std::vector<std::pair<NodeIter, NodeIter>>& cells){
+    if (last - first <= max_size){
+        cells.push_back({first, last});
+        return;
+    }
+    double min_x = std::numeric_limits<double>::infinity(), max_x = -min_x;
+    double min_y = min_x, max_y = max_x;
+    for (NodeIter node = first; node != last; ++node){
+        min_x = std::min(min_x, xy[*node].first);
+        max_x = std::max(max_x, xy[*node].first);
+        min_y = std::min(min_y, xy[*node].second);
+        max_y = std::max(max_y, xy[*node].second);
+    }
+    bool split_x = (max_x - min_x) >= (max_y - min_y);
+    NodeIter middle = first + (last - first) / 2;
+    std::nth_element(first, middle, last, [&](IntersectionIdx a, IntersectionIdx b){
+        return split_x ? xy[a].first < xy[b].first : xy[a].second < xy[b].second;
+    });
+    bisect(first, middle, max_size, xy, cells);
+    bisect(middle, last, max_size, xy, cells);
+}
+
+static void markBoundary(CrpLevel& level, IntersectionIdx inter){
+    if (level.boundary_index[inter] == -1){
+        std::vector<IntersectionIdx>& cell_boundary = level.boundary[level.cell_of[inter]];
+        level.boundary_index[inter] = cell_boundary.size();
+        cell_boundary.push_back(inter);
+    }
+}
+
+// cuts the map into nested cells, coarsest level first so every cell is split inside its parent
+static void buildPartition(){
+    const RoutingGraph& graph = routing_graph;
+    int num_intersections = graph.numIntersections();
+
+    // longitude is scaled by cos(latitude) so both axes are in comparable distances
+    std::vector<std::pair<double, double>> xy(num_intersections);
+    double sum_lat = 0;
+    for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+        sum_lat += getIntersectionPosition(inter).latitude();
+    }
+    double lon_scale = std::cos(kDegreeToRadian * sum_lat / std::max(num_intersections, 1));
+    for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+        LatLon position = getIntersectionPosition(inter);
+        xy[inter] = {position.longitude() * lon_scale, position.latitude()};
+    }
+
+    int num_levels = 0;
+    for (int cell_size : CRP_CELL_SIZES){
+        if (cell_size < num_intersections){
+            num_levels++;
+        }
+    }
+    crp_levels.assign(num_levels, CrpLevel());
+
+    std::vector<IntersectionIdx> order(num_intersections);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<std::pair<NodeIter, NodeIter>> parents = {{order.begin(), order.end()}};
+    for (int level = num_levels - 1; level >= 0; level--){
+        std::vector<std::pair<NodeIter, NodeIter>> cells;
+        for (const auto& [first, last] : parents){
+            bisect(first, last, CRP_CELL_SIZES[level], xy, cells);
+        }
+
+        CrpLevel& lv = crp_levels[level];
+        lv.cell_of.assign(num_intersections, -1);
+        for (int cell = 0; cell < (int)cells.size(); cell++){
+            for (NodeIter node = cells[cell].first; node != cells[cell].second; ++node){
+                lv.cell_of[*node] = cell;
+            }
+        }
+        lv.boundary.assign(cells.size(), {});
+        lv.boundary_index.assign(num_intersections, -1);
+        for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+            for (int e = graph.first_out[inter]; e < graph.first_out[inter + 1]; e++){
+                IntersectionIdx other = graph.out_edges[e].to;
+                if (lv.cell_of[inter] != lv.cell_of[other]){
+                    markBoundary(lv, inter);
+                    markBoundary(lv, other);
+                }
+            }
+        }
+        parents = std::move(cells);
+    }
+}
+
+
+/********************************************************************************/
+/********************************Customization***********************************/
+/********************************************************************************/
+
+// Runs a search from every boundary intersection of a cell to the others without leaving the cell.
+// Level 0 walks street segments; higher levels walk the cliques of the sub-cells and the segments between
+// them, which is why the levels are customized bottom-up.
+static std::shared_ptr<const std::vector<double>> customizeCell(int level, int cell, const CrpMetric& metric){
+    const RoutingGraph& graph = routing_graph;
+    const WeightSnapshot& weights = *metric.weights;
+    const CrpLevel& lv = crp_levels[level];
+    const std::vector<IntersectionIdx>& boundary = lv.boundary[cell];
+    int num_boundary = boundary.size();
+    auto clique = std::make_shared<std::vector<double>>(num_boundary * num_boundary, std::numeric_limits<double>::infinity());
+
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    BinaryHeapQueue& toVisit = overlayQueue();
+    for (int source = 0; source < num_boundary; source++){
+        workspace.reset();
+        toVisit.clear();
+        toVisit.update(boundary[source], 0.0);
+        workspace.label(boundary[source], 0.0, -1, -1);
+        auto relax = [&](IntersectionIdx to, double time, IntersectionIdx from){
+            if (time < workspace.time(to)){
+                workspace.label(to, time, -1, from);
+                toVisit.update(to, time);
+            }
+        };
+
+        int targets_left = num_boundary;
+        while (!toVisit.empty() && targets_left > 0){
+            int curr = toVisit.pop().node;
+            if (workspace.isSettled(curr)){
+                continue;
+            }
+            workspace.settle(curr);
+            double currTime = workspace.time(curr);
+            if (lv.boundary_index[curr] >= 0){
+                (*clique)[source * num_boundary + lv.boundary_index[curr]] = currTime;
+                targets_left--;
+            }
+
+            if (level == 0){
+                for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+                    const RoutingEdge& edge = graph.out_edges[e];
+                    if (lv.cell_of[edge.to] == cell){
+                        relax(edge.to, currTime + weights.time(edge.segment), curr);
+                    }
+                }
+                continue;
+            }
+            // everything this search reaches is on the boundary of its sub-cell
+            const CrpLevel& sub = crp_levels[level - 1];
+            int sub_cell = sub.cell_of[curr];
+            const std::vector<IntersectionIdx>& sub_boundary = sub.boundary[sub_cell];
+            const std::vector<double>& sub_clique = *metric.cliques[level - 1][sub_cell];
+            int row = sub.boundary_index[curr] * sub_boundary.size();
+            for (int j = 0; j < (int)sub_boundary.size(); j++){
+                relax(sub_boundary[j], currTime + sub_clique[row + j], curr);
+            }
+            for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+                const RoutingEdge& edge = graph.out_edges[e];
+                if (sub.cell_of[edge.to] != sub_cell && lv.cell_of[edge.to] == cell){
+                    relax(edge.to, currTime + weights.time(edge.segment), curr);
+                }
+            }
+        }
+    }
+    return clique;
+}
+
+// recomputes the listed cells of every level on the worker pool, finest level first
+static void customizeCells(CrpMetric& metric, const std::vector<std::vector<int>>& dirty_cells){
+    WorkStealingPool& pool = WorkStealingPool::instance();
+    for (int level = 0; level < (int)crp_levels.size(); level++){
+        const std::vector<int>& cells = dirty_cells[level];
+        pool.parallelFor(cells.size(), [&](int k, unsigned){
+            metric.cliques[level][cells[k]] = customizeCell(level, cells[k], metric);
+        });
+    }
+}
+
+// A traffic update only changes the cliques of cells that contain both ends of a changed segment; segments
+// between cells are read straight from the weights at query time.
+static void recustomize(const std::shared_ptr<const WeightSnapshot>& weights, const std::vector<StreetSegmentIdx>& changed){
+    std::lock_guard<std::mutex> customize(customize_lock);
+    std::shared_ptr<const CrpMetric> previous = std::atomic_load(&crp_metric);
+    if (!previous){
+        return;
+    }
+
+    // the new metric shares the cliques of every clean cell with the previous one
+    auto metric = std::make_shared<CrpMetric>(*previous);
+    metric->weights = weights;
+    std::vector<std::vector<int>> dirty_cells(crp_levels.size());
+    for (int level = 0; level < (int)crp_levels.size(); level++){
+        const CrpLevel& lv = crp_levels[level];
+        std::vector<bool> dirty(lv.boundary.size(), false);
+        for (StreetSegmentIdx seg : changed){
+            StreetSegmentInfo info = getStreetSegmentInfo(seg);
+            int cell = lv.cell_of[info.from];
+            if (cell == lv.cell_of[info.to] && !dirty[cell]){
+                dirty[cell] = true;
+                dirty_cells[level].push_back(cell);
+            }
+        }
+    }
+    customizeCells(*metric, dirty_cells);
+    std::atomic_store(&crp_metric, std::shared_ptr<const CrpMetric>(std::move(metric)));
+}
+
+void buildCrpOverlay(){
+    clearCrpOverlay();
+    buildPartition();
+    // listen before reading the weights so no update can slip in between; updates that arrive before the
+    // metric is published are already part of the snapshot read below
+    crp_listener = addWeightListener(recustomize);
+
+    std::lock_guard<std::mutex> customize(customize_lock);
+    auto metric = std::make_shared<CrpMetric>();
+    metric->weights = currentWeights();
+    std::vector<std::vector<int>> all_cells(crp_levels.size());
+    for (int level = 0; level < (int)crp_levels.size(); level++){
+        int num_cells = crp_levels[level].boundary.size();
+        metric->cliques.emplace_back(num_cells);
+        all_cells[level].resize(num_cells);
+        std::iota(all_cells[level].begin(), all_cells[level].end(), 0);
+    }
+    customizeCells(*metric, all_cells);
+    std::atomic_store(&crp_metric, std::shared_ptr<const CrpMetric>(std::move(metric)));
+}
+
+void clearCrpOverlay(){
+    if (crp_listener != -1){
+        removeWeightListener(crp_listener);
+        crp_listener = -1;
+    }
+    std::lock_guard<std::mutex> customize(customize_lock);
+    std::atomic_store(&crp_metric, std::shared_ptr<const CrpMetric>());
+    crp_levels.clear();
+}
+
+
+/********************************************************************************/
+/************************************Queries*************************************/
+/********************************************************************************/
+
+// appends the street segments of a clique arc by searching the cell it crosses on the street graph
+template <class Stats>
+static void unpackCliqueArc(int level, IntersectionIdx from, IntersectionIdx to, const WeightSnapshot& weights, std::vector<StreetSegmentIdx>& path, Stats& stats){
+    const RoutingGraph& graph = routing_graph;
+    const CrpLevel& lv = crp_levels[level];
+    int cell = lv.cell_of[from];
+    // slot 1, since the overlay search's labels in slot 0 are still being read
+    SearchWorkspace& workspace = threadSearchWorkspace(1);
+    BinaryHeapQueue& toVisit = overlayQueue();
+    workspace.reset();
+    toVisit.clear();
+    toVisit.update(from, 0.0);
+    stats.pushed(toVisit.size());
+    workspace.label(from, 0.0, -1, -1);
+    while (!toVisit.empty()){
+        int curr = toVisit.pop().node;
+        stats.popped();
+        if (workspace.isSettled(curr)){
+            continue;
+        }
+        workspace.settle(curr);
+        stats.settled();
+        if (curr == to){
+            break;
+        }
+        double currTime = workspace.time(curr);
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+            const RoutingEdge& edge = graph.out_edges[e];
+            stats.relaxed();
+            double totalTime = currTime + weights.time(edge.segment);
+            if (lv.cell_of[edge.to] == cell && totalTime < workspace.time(edge.to)){
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+                stats.pushed(toVisit.size());
+            }
+        }
+    }
+
+    std::vector<StreetSegmentIdx> inside;
+    for (IntersectionIdx inter = to; workspace.prevEdge(inter) != -1; inter = workspace.prevNode(inter)){
+        inside.push_back(workspace.prevEdge(inter));
+    }
+    path.insert(path.end(), inside.rbegin(), inside.rend());
+}
+
+std::vector<StreetSegmentIdx> findOverlayPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids){
+    NoSearchStats stats;
+    return findOverlayPath(intersect_ids, stats);
+}
+
+template <class Stats>
+std::vector<StreetSegmentIdx> findOverlayPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, Stats& stats){
+    std::shared_ptr<const CrpMetric> metric = std::atomic_load(&crp_metric);
+    if (!metric){
+        std::vector<StreetSegmentIdx> path;
+        dijkstra(intersect_ids.first, intersect_ids.second, path, 0, threadSearchWorkspace(), stats);
+        return path;
+    }
+    const RoutingGraph& graph = routing_graph;
+    const WeightSnapshot& weights = *metric->weights;
+    IntersectionIdx start = intersect_ids.first;
+    IntersectionIdx destination = intersect_ids.second;
+    int num_levels = crp_levels.size();
+
+    // the coarsest level at which an intersection shares a cell with neither end of the query; -1 means the
+    // street segments around it have to be searched directly
+    auto queryLevel = [&](IntersectionIdx inter){
+        for (int level = num_levels - 1; level >= 0; level--){
+            const std::vector<int>& cell_of = crp_levels[level].cell_of;
+            if (cell_of[inter] != cell_of[start] && cell_of[inter] != cell_of[destination]){
+                return level;
+            }
+        }
+        return -1;
+    };
+
+    SearchWorkspace& workspace = threadSearchWorkspace(0);
+    BinaryHeapQueue& toVisit = overlayQueue();
+    workspace.reset();
+    toVisit.clear();
+    toVisit.update(start, 0.0);
+    stats.pushed(toVisit.size());
+    workspace.label(start, 0.0, -1, -1);
+    while (!toVisit.empty()){
+        int curr = toVisit.pop().node;
+        stats.popped();
+        if (workspace.isSettled(curr)){
+            continue;
+        }
+        workspace.settle(curr);
+        stats.settled();
+        if (curr == destination){
+            break;
+        }
+        double currTime = workspace.time(curr);
+        auto relax = [&](IntersectionIdx to, double time, int via){
+            stats.relaxed();
+            if (time < workspace.time(to)){
+                workspace.label(to, time, via, curr);
+                toVisit.update(to, time);
+                stats.pushed(toVisit.size());
+            }
+        };
+
+        int level = queryLevel(curr);
+        if (level < 0){
+            for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+                const RoutingEdge& edge = graph.out_edges[e];
+                relax(edge.to, currTime + weights.time(edge.segment), edge.segment);
+            }
+            continue;
+        }
+        // curr was entered from outside its cell, so it is on the boundary: cross the cell through the
+        // clique, or leave it along a segment
+        const CrpLevel& lv = crp_levels[level];
+        int cell = lv.cell_of[curr];
+        const std::vector<IntersectionIdx>& boundary = lv.boundary[cell];
+        const std::vector<double>& clique = *metric->cliques[level][cell];
+        int row = lv.boundary_index[curr] * boundary.size();
+        for (int j = 0; j < (int)boundary.size(); j++){
+            relax(boundary[j], currTime + clique[row + j], CLIQUE_ARC - level);
+        }
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++){
+            const RoutingEdge& edge = graph.out_edges[e];
+            if (lv.cell_of[edge.to] != cell){
+                relax(edge.to, currTime + weights.time(edge.segment), edge.segment);
+            }
+        }
+    }
+    if (!workspace.isSettled(destination)){
+        return {};
+    }
+
+    // collect the arcs from the destination back to the start, then expand them in driving order
+    struct OverlayArc {
+        IntersectionIdx from;
+        IntersectionIdx to;
+        int via;
+    };
+    std::vector<OverlayArc> arcs;
+    for (IntersectionIdx inter = destination; workspace.prevNode(inter) != -1; inter = workspace.prevNode(inter)){
+        arcs.push_back({workspace.prevNode(inter), inter, workspace.prevEdge(inter)});
+    }
+    std::vector<StreetSegmentIdx> path;
+    for (auto arc = arcs.rbegin(); arc != arcs.rend(); ++arc){
+        if (arc->via >= 0){
+            path.push_back(arc->via);
+        } else {
+            unpackCliqueArc(CLIQUE_ARC - arc->via, arc->from, arc->to, weights, path, stats);
+        }
+    }
+    return path;
+}
+
+template std::vector<StreetSegmentIdx> findOverlayPath<NoSearchStats>(const std::pair<IntersectionIdx, IntersectionIdx>, NoSearchStats&);
+template std::vector<StreetSegmentIdx> findOverlayPath<CountingSearchStats>(const std::pair<IntersectionIdx, IntersectionIdx>, CountingSearchStats&);
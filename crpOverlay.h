@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include "StreetsDatabaseAPI.h"
+
+// Customizable route planning: the intersections are split into nested cells (geometric recursive
+// bisection, finest level first), and every cell stores a clique of travel times between its boundary
+// intersections. The partition only depends on the street layout; the cliques ("customization") are
+// recomputed in parallel, and only for the cells whose segments changed, whenever traffic updates arrive.
+// Queries step over whole cells through the cliques instead of searching their insides.
+// The overlay ignores turn penalties: a clique holds one time per boundary pair, which cannot depend on
+// the street the car arrived on.
+
+// largest number of intersections in a cell at each level, finest level first
+// levels at least as large as the map are skipped
+const int CRP_CELL_SIZES[] = {128, 2048, 32768};
+
+// partitions the loaded map, customizes every cell for the current weights and starts following
+// traffic updates; call after loadMap
+void buildCrpOverlay();
+// stops following traffic updates and frees the overlay (called by closeMap)
+void clearCrpOverlay();
+
+// Fastest path without turn penalties, found over the overlay and unpacked into street segments.
+// Its travel time equals that of findPathBetweenIntersections(intersect_ids, 0); ties may pick another path.
+// Falls back to plain dijkstra if the overlay has not been built.
+std::vector<StreetSegmentIdx> findOverlayPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids);
+// the same query reporting to a statistics policy (see routingFunctions.h); the searches that unpack
+// clique arcs are counted too
+template <class Stats>
+std::vector<StreetSegmentIdx> findOverlayPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, Stats& stats);
@@ -4,23 +4,43 @@ const double POI_FONT_SIZE = 50;
 const double DEGREES_90 = 90;
 const double DEGREES_180 = 180;
 const double INTERSECTION_WIDTH = 10;
+const double ISOCHRONE_WIDTH = 4;
+// pixels around the drawn area in which street segments are still drawn, half the widest street line
+const double STREET_CULL_MARGIN = 20;
 
-// This function draws all the intersections
+// street segment polylines that share a color and width, collected so they can be stroked together
+struct PolylineBatch {
+   ezgl::color color;
+   int width;
+   // the points of every polyline one after the other, with sizes[i] points in polyline i
+   std::vector<ezgl::point2d> points;
+   std::vector<size_t> sizes;
+};
+
+// This function draws all the highlighted intersections
 void drawIntersections(ezgl::renderer *g);
+// Returns the area covered by an intersection's highlight
+ezgl::rectangle intersectionHighlightBounds(IntersectionIdx inter_id);
 // This function draws the curve points that compose a street segment
 void drawStreetSegments(ezgl::renderer *g, int level);
-// This function is a helper function to draw the curve points for a given street segment
-void drawSegmentHelper(ezgl::renderer *g, StreetSegment_Data segment, int num_curve_points, std::vector<ezgl::point2d> points);
-// This function draws the names of all the streets
-void drawStreetNames(ezgl::renderer *g);
+// Returns the batch with the given color and width among the first num_batches, starting a new one if needed
+PolylineBatch& batchFor(std::vector<PolylineBatch>& batches, int& num_batches, ezgl::color color, int width);
+// Adds the curve points of a street segment, with its end points, to a batch as one polyline
+void addSegmentToBatch(PolylineBatch& batch, const StreetSegment_Data& segment);
+// Draws all the polylines of a batch with a single stroke
+void drawBatch(ezgl::renderer *g, const PolylineBatch& batch);
+// Draws the isochrone segments over the streets
+void drawIsochrone(ezgl::renderer *g);
+// Draws the segments of the last path found over the streets
+void drawHighlightedPath(ezgl::renderer *g);
 // This function is a helper function to draw and fill map features
 void drawFeatures(ezgl::renderer *g);
 // Returns the bounds of the given feature
 ezgl::rectangle getFeatureBounds(int feature_id);
 //Checks if the two given rectangle areas intersect
 bool intersects(const ezgl::rectangle& rect1, const ezgl::rectangle& rect2);
-// Allows comparison of two different areas
-bool compareFeatureArea(const FeatureArea& f1, const FeatureArea& f2);
+// Returns the fill color of a feature type in the current (day or night) mode
+ezgl::color featureColor(FeatureType feature_type);
 // This function draws the name of a POI at the centroid of its shape
 void drawPOINames(ezgl::renderer *g);
 // This function draws the surrounding polygons of a street segment
@@ -29,5 +49,3 @@ void drawSurroundingPolygons(ezgl::renderer* g, StreetSegmentIdx ss_id);
 void drawPOIIcons(ezgl::renderer *g);
 // Finds the segment data from the data structure
 StreetSegment_Data findSegmentData(StreetSegmentIdx seg);
-// organize streets with OSM order of precidance 
-std::vector<std::vector<StreetSegment_Data>> streetsByPriority();
\ No newline at end of file
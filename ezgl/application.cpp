@@ -691,6 +691,33 @@ void application::refresh_drawing()
   cnv->redraw();
 }
 
+void application::refresh_layer(std::string const &name)
+{
+  // get the main canvas
+  canvas *cnv = get_canvas(m_canvas_id);
+
+  // redraw only the layer
+  cnv->redraw_layer(name);
+}
+
+void application::invalidate_drawing(rectangle world_region, double padding)
+{
+  // get the main canvas
+  canvas *cnv = get_canvas(m_canvas_id);
+
+  // redraw the overlay in the region only
+  cnv->invalidate(world_region, padding);
+}
+
+void application::refresh_overlay()
+{
+  // get the main canvas
+  canvas *cnv = get_canvas(m_canvas_id);
+
+  // redraw the whole overlay only
+  cnv->invalidate();
+}
+
 void application::flush_drawing()
 {
   // get the main drawing area widget
@@ -437,6 +437,29 @@ public:
    */
   void refresh_drawing();
 
+  /**
+   * Redraw one layer of the main canvas, reusing the last drawing of its other layers (see canvas::add_layer)
+   *
+   * @param name The name of the layer, BASE_LAYER for the one drawn by the canvas' draw callback.
+   */
+  void refresh_layer(std::string const &name);
+
+  /**
+   * Redraw the overlay of the main canvas inside a region of the world, reusing the rest of the last drawing
+   *
+   * Much cheaper than refresh_drawing when only what the overlay callback draws has changed (see
+   * canvas::set_overlay_callback), since no layer is redrawn.
+   *
+   * @param world_region The region that changed, in world coordinates.
+   * @param padding Pixels to add on every side of the region.
+   */
+  void invalidate_drawing(rectangle world_region, double padding = 0);
+
+  /**
+   * Redraw the whole overlay of the main canvas, reusing the rest of the last drawing
+   */
+  void refresh_overlay();
+
   /**
    * Get a renderer that can be used to draw on top of the main canvas
    * 
@@ -31,10 +31,6 @@ struct mouse_pan {
    * Tracks whether the mouse button used for panning is currently pressed
    */
   bool panning_mouse_button_pressed = false;
-  /**
-   * Holds the timestamp of the last panning event
-   */
-  int last_panning_event_time = 0;
   /**
    * The old x and y positions of the mouse pointer, in the previous pan 
    * event.
@@ -133,34 +129,18 @@ gboolean move_mouse(GtkWidget *, GdkEventButton *event, gpointer data)
 
     // Check if the mouse button is pressed to support dragging
     if(g_mouse_pan.panning_mouse_button_pressed) {
-      // Code below drops a panning event if we served anothe one 
-      // less than 100 ms. I believe it was intended to avoid having panning
-      // fall behind and queue up many events if redraws were slow. However,
-      // it is not necessary on the UG machines (debian) in person, or over 
-      // VNC or on a VM and it has the bad effect of limiting refresh to 10 Hz.
-      // Commenting it out for now and will delete if there 
-      // are no reported issues. - VB
-      // if(gtk_get_current_event_time() - g_mouse_pan.last_panning_event_time < 100)
-       // return true;
-
-      g_mouse_pan.last_panning_event_time = gtk_get_current_event_time();
-
       GdkEventMotion *motion_event = (GdkEventMotion *)event;
 
       std::string main_canvas_id = application->get_main_canvas_id();
       auto canvas = application->get_canvas(main_canvas_id);
 
-      point2d curr_trans = canvas->get_camera().widget_to_world({motion_event->x, motion_event->y});
-      point2d prev_trans = canvas->get_camera().widget_to_world({g_mouse_pan.prev_x, g_mouse_pan.prev_y});
-
-      double dx = curr_trans.x - prev_trans.x;
-      double dy = curr_trans.y - prev_trans.y;
+      // Move the drawing along with the pointer. The canvas adds up the motion events of a frame and shifts the
+      // drawing once per frame, so panning cannot fall behind however many events arrive.
+      canvas->pan(motion_event->x - g_mouse_pan.prev_x, motion_event->y - g_mouse_pan.prev_y);
 
       g_mouse_pan.prev_x = motion_event->x;
       g_mouse_pan.prev_y = motion_event->y;
 
-      // Flip the delta x to avoid inverted dragging
-      translate(canvas, -dx, -dy);
       g_mouse_pan.has_panned = true;
     }
     // Else call the user-defined mouse move callback if defined
@@ -192,11 +172,11 @@ gboolean scroll_mouse(GtkWidget *, GdkEvent *event, gpointer data)
     ezgl::point2d scroll_point(scroll_event->x, scroll_event->y);
 
     if(scroll_event->direction == GDK_SCROLL_UP) {
-      // Zoom in at the scroll point
-      ezgl::zoom_in(canvas, scroll_point, 5.0 / 3.0);
+      // Zoom in at the scroll point; the view animates there and is redrawn once the wheel stops
+      ezgl::animated_zoom_in(canvas, scroll_point, 5.0 / 3.0);
     } else if(scroll_event->direction == GDK_SCROLL_DOWN) {
-      // Zoom out at the scroll point
-      ezgl::zoom_out(canvas, scroll_point, 5.0 / 3.0);
+      // Zoom out at the scroll point; the view animates there and is redrawn once the wheel stops
+      ezgl::animated_zoom_out(canvas, scroll_point, 5.0 / 3.0);
     } else if(scroll_event->direction == GDK_SCROLL_SMOOTH) {
       // Doesn't seem to be happening
     } // NOTE: We ignore scroll GDK_SCROLL_LEFT and GDK_SCROLL_RIGHT
@@ -18,9 +18,14 @@
 
 #include "ezgl/camera.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
 namespace ezgl {
 
 static rectangle maintain_aspect_ratio(rectangle const &view, double widget_width, double widget_height)
@@ -58,6 +63,7 @@ static rectangle maintain_aspect_ratio(rectangle const &view, double widget_widt
 
 camera::camera(rectangle bounds) : m_world(bounds), m_screen(bounds), m_initial_world(bounds)
 {
+  update_world_to_screen();
 }
 
 point2d camera::widget_to_screen(point2d widget_coordinates) const
@@ -93,16 +99,7 @@ point2d camera::widget_to_world(point2d widget_coordinates) const
 
 point2d camera::world_to_screen(point2d world_coordinates) const
 {
-  point2d const world_origin{m_world.left(), m_world.bottom()};
-  point2d widget_coordinates = (world_coordinates - world_origin) * m_world_to_widget;
-
-  // GTK and cairo use a flipped y-axis.
-  widget_coordinates.y = (widget_coordinates.y - m_widget.top()) * -1.0;
-
-  point2d screen_coordinates = widget_coordinates * m_widget_to_screen;
-
-  point2d const screen_origin = {m_screen.left(), m_screen.bottom()};
-  screen_coordinates = screen_coordinates + screen_origin;
+  point2d screen_coordinates = world_coordinates * m_world_to_screen_scale + m_world_to_screen_offset;
 
   screen_coordinates.x = std::max(screen_coordinates.x, MINPIXEL);
   screen_coordinates.y = std::max(screen_coordinates.y, MINPIXEL);
@@ -112,6 +109,33 @@ point2d camera::world_to_screen(point2d world_coordinates) const
   return screen_coordinates;
 }
 
+void camera::world_to_screen(point2d const *world, point2d *screen, std::size_t count) const
+{
+  std::size_t i = 0;
+
+#ifdef __AVX__
+  // Each register holds two points as (x, y, x, y), which relies on point2d being two packed doubles.
+  static_assert(sizeof(point2d) == 2 * sizeof(double), "point2d must be two packed doubles");
+
+  __m256d const scale = _mm256_setr_pd(
+      m_world_to_screen_scale.x, m_world_to_screen_scale.y, m_world_to_screen_scale.x, m_world_to_screen_scale.y);
+  __m256d const offset = _mm256_setr_pd(
+      m_world_to_screen_offset.x, m_world_to_screen_offset.y, m_world_to_screen_offset.x, m_world_to_screen_offset.y);
+  __m256d const min_pixel = _mm256_set1_pd(MINPIXEL);
+  __m256d const max_pixel = _mm256_set1_pd(MAXPIXEL);
+
+  for(; i + 2 <= count; i += 2) {
+    __m256d points = _mm256_loadu_pd(&world[i].x);
+    points = _mm256_add_pd(_mm256_mul_pd(points, scale), offset);
+    points = _mm256_min_pd(_mm256_max_pd(points, min_pixel), max_pixel);
+    _mm256_storeu_pd(&screen[i].x, points);
+  }
+#endif
+
+  for(; i < count; ++i)
+    screen[i] = world_to_screen(world[i]);
+}
+
 void camera::set_world(rectangle new_world)
 {
   m_world = new_world;
@@ -148,5 +172,22 @@ void camera::update_scale_factors()
 
   m_screen_to_world.x = m_world.width() / m_screen.width();
   m_screen_to_world.y = m_world.height() / m_screen.height();
+
+  update_world_to_screen();
+}
+
+void camera::update_world_to_screen()
+{
+  // world -> widget: (world - world_origin) * world_to_widget, with the y-axis flipped about the widget's top
+  // widget -> screen: widget * widget_to_screen + screen_origin
+  point2d const world_origin{m_world.left(), m_world.bottom()};
+  point2d const screen_origin = {m_screen.left(), m_screen.bottom()};
+
+  m_world_to_screen_scale.x = m_world_to_widget.x * m_widget_to_screen.x;
+  m_world_to_screen_scale.y = -m_world_to_widget.y * m_widget_to_screen.y;
+
+  m_world_to_screen_offset.x = screen_origin.x - world_origin.x * m_world_to_screen_scale.x;
+  m_world_to_screen_offset.y =
+      screen_origin.y + (m_widget.top() + world_origin.y * m_world_to_widget.y) * m_widget_to_screen.y;
 }
 }
@@ -22,12 +22,20 @@
 
 #include <gtk/gtk.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <functional>
 
 namespace ezgl {
 
+// How long an animated view change takes, in microseconds (the unit of the GDK frame clock).
+static double const VIEW_ANIMATION_DURATION = 150000.0;
+
+// Draw calls within this many pixels of a strip uncovered by a pan are still made, so wide lines and icons that
+// reach into the strip from the part of the drawing that was kept are drawn across the seam.
+static double const PAN_STRIP_PADDING = 32.0;
+
 static cairo_surface_t *create_surface(GtkWidget *widget)
 {
   GdkWindow *parent_window = gtk_widget_get_window(widget);
@@ -90,11 +98,13 @@ bool canvas::print_pdf(const char *file_name, int output_width, int output_heigh
       m_background_color.blue / 255.0);
   cairo_paint(context);
 
-  using namespace std::placeholders;
   camera pdf_cam = m_camera;
   pdf_cam.update_widget(surface_width, surface_height);
-  renderer g(context, std::bind(&camera::world_to_screen, pdf_cam, _1), &pdf_cam, pdf_surface);
-  m_draw_callback(&g);
+  renderer g(context, [pdf_cam](point2d world) { return pdf_cam.world_to_screen(world); }, &pdf_cam, pdf_surface);
+  for(layer &output_layer : m_layers)
+    output_layer.draw_callback(&g);
+  if(m_overlay_callback != nullptr)
+    m_overlay_callback(&g);
 
   // free surface & context
   cairo_surface_destroy(pdf_surface);
@@ -129,11 +139,13 @@ bool canvas::print_svg(const char *file_name, int output_width, int output_heigh
       m_background_color.blue / 255.0);
   cairo_paint(context);
 
-  using namespace std::placeholders;
   camera svg_cam = m_camera;
   svg_cam.update_widget(surface_width, surface_height);
-  renderer g(context, std::bind(&camera::world_to_screen, svg_cam, _1), &svg_cam, svg_surface);
-  m_draw_callback(&g);
+  renderer g(context, [svg_cam](point2d world) { return svg_cam.world_to_screen(world); }, &svg_cam, svg_surface);
+  for(layer &output_layer : m_layers)
+    output_layer.draw_callback(&g);
+  if(m_overlay_callback != nullptr)
+    m_overlay_callback(&g);
 
   // free surface & context
   cairo_surface_destroy(svg_surface);
@@ -168,11 +180,13 @@ bool canvas::print_png(const char *file_name, int output_width, int output_heigh
       m_background_color.blue / 255.0);
   cairo_paint(context);
 
-  using namespace std::placeholders;
   camera png_cam = m_camera;
   png_cam.update_widget(surface_width, surface_height);
-  renderer g(context, std::bind(&camera::world_to_screen, png_cam, _1), &png_cam, png_surface);
-  m_draw_callback(&g);
+  renderer g(context, [png_cam](point2d world) { return png_cam.world_to_screen(world); }, &png_cam, png_surface);
+  for(layer &output_layer : m_layers)
+    output_layer.draw_callback(&g);
+  if(m_overlay_callback != nullptr)
+    m_overlay_callback(&g);
 
   // create png output file
   cairo_surface_write_to_png(png_surface, file_name);
@@ -207,6 +221,19 @@ gboolean canvas::configure_event(GtkWidget *widget, GdkEventConfigure *, gpointe
   // Recreate the context
   p_context = create_context(p_surface);
 
+  // The layer surfaces have to match the new size as well
+  ezgl_canvas->update_layer_surfaces();
+
+  // So does the scratch surface, which the next pan recreates
+  if(ezgl_canvas->m_scratch_surface != nullptr) {
+    cairo_surface_destroy(ezgl_canvas->m_scratch_surface);
+    ezgl_canvas->m_scratch_surface = nullptr;
+  }
+
+  // The animation snapshot no longer matches the widget; jump to where the animation was going instead
+  if(ezgl_canvas->m_animation_tick_id != 0)
+    ezgl_canvas->m_camera.set_world(ezgl_canvas->m_animation_target_world);
+
   // The camera needs to be updated before we start drawing again.
   ezgl_canvas->m_camera.update_widget(ezgl_canvas->width(), ezgl_canvas->height());
 
@@ -238,10 +265,10 @@ canvas::canvas(std::string canvas_id,
     rectangle coordinate_system,
     color background_color)
     : m_canvas_id(std::move(canvas_id))
-    , m_draw_callback(draw_callback)
     , m_camera(coordinate_system)
     , m_background_color(background_color)
 {
+  m_layers.push_back({BASE_LAYER, draw_callback});
 }
 
 canvas::~canvas()
@@ -254,6 +281,25 @@ canvas::~canvas()
     cairo_destroy(m_context);
   }
 
+  for(layer &cached_layer : m_layers) {
+    if(cached_layer.surface != nullptr) {
+      cairo_surface_destroy(cached_layer.surface);
+    }
+
+    if(cached_layer.context != nullptr) {
+      cairo_destroy(cached_layer.context);
+    }
+  }
+
+  // The drawing area, and any frame clock callback with it, is destroyed before the canvas
+  if(m_animation_snapshot != nullptr) {
+    cairo_surface_destroy(m_animation_snapshot);
+  }
+
+  if(m_scratch_surface != nullptr) {
+    cairo_surface_destroy(m_scratch_surface);
+  }
+
   if(m_animation_renderer != nullptr) {
     delete m_animation_renderer;
   }
@@ -276,6 +322,7 @@ void canvas::initialize(GtkWidget *drawing_area)
   m_drawing_area = drawing_area;
   m_surface = create_surface(m_drawing_area);
   m_context = create_context(m_surface);
+  update_layer_surfaces();
   m_camera.update_widget(width(), height());
 
   // Draw to the newly created surface for the first time.
@@ -297,25 +344,414 @@ void canvas::initialize(GtkWidget *drawing_area)
 
 void canvas::redraw()
 {
-  // Clear the screen and set the background color
+  // Whatever moved the camera, the drawing now follows it rather than the animation
+  stop_animation();
+
+  if(!caches_layers()) {
+    // Clear the screen and set the background color
+    cairo_set_source_rgb(m_context, m_background_color.red / 255.0, m_background_color.green / 255.0,
+        m_background_color.blue / 255.0);
+    cairo_paint(m_context);
+
+    renderer g(m_context, [this](point2d world) { return m_camera.world_to_screen(world); }, &m_camera, m_surface);
+    m_layers[0].draw_callback(&g);
+  } else {
+    for(size_t i = 0; i < m_layers.size(); ++i)
+      draw_layer(m_layers[i], i == 0, nullptr);
+
+    composite(nullptr);
+  }
+
+  gtk_widget_queue_draw(m_drawing_area);
+
+  g_info("The canvas will be redrawn.");
+}
+
+void canvas::add_layer(std::string const &name, draw_canvas_fn draw_callback)
+{
+  for(layer const &existing_layer : m_layers) {
+    if(existing_layer.name == name) {
+      g_warning("Duplicate layer (%s) ignored in canvas::add_layer.", name.c_str());
+      return;
+    }
+  }
+
+  m_layers.push_back({name, draw_callback});
+
+  // Once the canvas is initialized, the new layer needs a surface and a first drawing
+  if(m_drawing_area != nullptr) {
+    update_layer_surfaces();
+    redraw();
+  }
+}
+
+void canvas::redraw_layer(std::string const &name)
+{
+  // The redraw at the end of the animation will show the change
+  if(m_animation_tick_id != 0)
+    return;
+
+  if(!caches_layers()) {
+    redraw();
+    return;
+  }
+
+  for(size_t i = 0; i < m_layers.size(); ++i) {
+    if(m_layers[i].name == name) {
+      draw_layer(m_layers[i], i == 0, nullptr);
+      composite(nullptr);
+
+      gtk_widget_queue_draw(m_drawing_area);
+      return;
+    }
+  }
+
+  g_warning("Unknown layer (%s) in canvas::redraw_layer.", name.c_str());
+}
+
+void canvas::set_overlay_callback(draw_canvas_fn overlay_callback)
+{
+  m_overlay_callback = overlay_callback;
+
+  // Once the canvas is initialized, switching between cached and uncached layers needs a full redraw
+  if(m_drawing_area != nullptr) {
+    update_layer_surfaces();
+    redraw();
+  }
+}
+
+void canvas::invalidate(rectangle world_region, double padding)
+{
+  // The animation is still showing the old drawing; the redraw that ends it shows the change
+  if(m_animation_tick_id != 0)
+    return;
+
+  if(!caches_layers()) {
+    redraw();
+    return;
+  }
+
+  // The region in pixels, grown by the padding, rounded out to whole pixels and clipped to the drawing area
+  point2d const corner_1 = m_camera.world_to_screen(world_region.bottom_left());
+  point2d const corner_2 = m_camera.world_to_screen(world_region.top_right());
+  double const left = std::max(std::floor(std::min(corner_1.x, corner_2.x) - padding), 0.0);
+  double const right = std::min(std::ceil(std::max(corner_1.x, corner_2.x) + padding), (double)width());
+  double const top = std::max(std::floor(std::min(corner_1.y, corner_2.y) - padding), 0.0);
+  double const bottom = std::min(std::ceil(std::max(corner_1.y, corner_2.y) + padding), (double)height());
+
+  if(right <= left || bottom <= top)
+    return;
+
+  rectangle const region({left, top}, {right, bottom});
+  composite(&region);
+
+  gtk_widget_queue_draw_area(m_drawing_area, (int)left, (int)top, (int)(right - left), (int)(bottom - top));
+}
+
+void canvas::invalidate()
+{
+  // The animation is still showing the old drawing; the redraw that ends it shows the change
+  if(m_animation_tick_id != 0)
+    return;
+
+  if(!caches_layers()) {
+    redraw();
+    return;
+  }
+
+  composite(nullptr);
+
+  gtk_widget_queue_draw(m_drawing_area);
+}
+
+void canvas::animate_to_world(rectangle target_world)
+{
+  // Nothing is shown yet, so there is nothing to animate
+  if(m_drawing_area == nullptr) {
+    m_camera.set_world(target_world);
+    return;
+  }
+
+  if(m_animation_tick_id == 0) {
+    // Keep the drawing shown now; it is what the animation moves and scales
+    m_animation_snapshot = create_surface(m_drawing_area);
+    cairo_t *snapshot_context = cairo_create(m_animation_snapshot);
+    cairo_set_source_surface(snapshot_context, m_surface, 0, 0);
+    cairo_paint(snapshot_context);
+    cairo_destroy(snapshot_context);
+
+    m_snapshot_scale = m_camera.m_world_to_screen_scale;
+    m_snapshot_offset = m_camera.m_world_to_screen_offset;
+
+    m_animation_tick_id = gtk_widget_add_tick_callback(m_drawing_area, animation_tick, this, nullptr);
+  }
+
+  // Start from the view shown now, so a new target while animating continues smoothly from it
+  m_animation_start_world = m_camera.get_world();
+  m_animation_target_world = target_world;
+  m_animation_start_time = -1;
+}
+
+rectangle canvas::get_target_world() const
+{
+  return m_animation_tick_id != 0 ? m_animation_target_world : m_camera.get_world();
+}
+
+void canvas::stop_animation()
+{
+  if(m_animation_tick_id != 0) {
+    gtk_widget_remove_tick_callback(m_drawing_area, m_animation_tick_id);
+    m_animation_tick_id = 0;
+  }
+
+  if(m_animation_snapshot != nullptr) {
+    cairo_surface_destroy(m_animation_snapshot);
+    m_animation_snapshot = nullptr;
+  }
+}
+
+void canvas::draw_animation_frame()
+{
+  // A snapshot pixel p shows the world point (p - snapshot offset) / snapshot scale, which is now at
+  // p * ratio + offset - snapshot offset * ratio
+  point2d const &scale = m_camera.m_world_to_screen_scale;
+  point2d const &offset = m_camera.m_world_to_screen_offset;
+  point2d const ratio = {scale.x / m_snapshot_scale.x, scale.y / m_snapshot_scale.y};
+
+  cairo_save(m_context);
+
+  // The background shows wherever the snapshot no longer covers the widget
   cairo_set_source_rgb(m_context, m_background_color.red / 255.0, m_background_color.green / 255.0,
       m_background_color.blue / 255.0);
   cairo_paint(m_context);
 
-  using namespace std::placeholders;
-  renderer g(m_context, std::bind(&camera::world_to_screen, &m_camera, _1), &m_camera, m_surface);
-  m_draw_callback(&g);
+  cairo_translate(m_context, offset.x - m_snapshot_offset.x * ratio.x, offset.y - m_snapshot_offset.y * ratio.y);
+  cairo_scale(m_context, ratio.x, ratio.y);
+  cairo_set_source_surface(m_context, m_animation_snapshot, 0, 0);
+  cairo_paint(m_context);
+
+  cairo_restore(m_context);
 
   gtk_widget_queue_draw(m_drawing_area);
+}
 
-  g_info("The canvas will be redrawn.");
+gboolean canvas::animation_tick(GtkWidget *, GdkFrameClock *frame_clock, gpointer data)
+{
+  auto ezgl_canvas = static_cast<canvas *>(data);
+
+  gint64 const now = gdk_frame_clock_get_frame_time(frame_clock);
+  if(ezgl_canvas->m_animation_start_time < 0)
+    ezgl_canvas->m_animation_start_time = now;
+
+  double const t = std::min((now - ezgl_canvas->m_animation_start_time) / VIEW_ANIMATION_DURATION, 1.0);
+
+  if(t >= 1.0) {
+    // Returning FALSE removes this callback, so only the snapshot is left to free
+    ezgl_canvas->m_animation_tick_id = 0;
+    ezgl_canvas->m_camera.set_world(ezgl_canvas->m_animation_target_world);
+    ezgl_canvas->redraw();
+    return FALSE;
+  }
+
+  // Ease out: move quickly at first and slow down into the target. Interpolating the corners keeps the world point
+  // that stays fixed in a zoom under the same pixel all the way through.
+  double const eased = t * (2.0 - t);
+  rectangle const &from = ezgl_canvas->m_animation_start_world;
+  rectangle const &to = ezgl_canvas->m_animation_target_world;
+  point2d const bottom_left = from.bottom_left() + (to.bottom_left() - from.bottom_left()) * point2d(eased, eased);
+  point2d const top_right = from.top_right() + (to.top_right() - from.top_right()) * point2d(eased, eased);
+
+  // The camera follows the animation, so clicks land on what is shown
+  ezgl_canvas->m_camera.set_world({bottom_left, top_right});
+  ezgl_canvas->draw_animation_frame();
+
+  return TRUE;
+}
+
+void canvas::pan(double dx, double dy)
+{
+  if(m_drawing_area == nullptr)
+    return;
+
+  m_pending_pan += point2d(dx, dy);
+
+  // Every pan before the next frame is applied by the same callback
+  if(m_pan_tick_id == 0)
+    m_pan_tick_id = gtk_widget_add_tick_callback(m_drawing_area, pan_tick, this, nullptr);
+}
+
+gboolean canvas::pan_tick(GtkWidget *, GdkFrameClock *, gpointer data)
+{
+  auto ezgl_canvas = static_cast<canvas *>(data);
+
+  // Returning FALSE removes this callback; the next pan adds it again
+  ezgl_canvas->m_pan_tick_id = 0;
+  ezgl_canvas->apply_pan();
+
+  return FALSE;
+}
+
+void canvas::apply_pan()
+{
+  // A pan takes over from a view animation, starting from where the animation was going
+  if(m_animation_tick_id != 0) {
+    m_camera.set_world(m_animation_target_world);
+    redraw();
+  }
+
+  // Shift by whole pixels so the kept drawing stays on the pixel grid; the fraction is kept for the next pan
+  double const dx = std::round(m_pending_pan.x);
+  double const dy = std::round(m_pending_pan.y);
+  m_pending_pan -= point2d(dx, dy);
+
+  if(dx == 0 && dy == 0)
+    return;
+
+  // The drawing moves with the mouse, so the world moves the other way
+  point2d const &scale = m_camera.m_world_to_screen_scale;
+  rectangle new_world = m_camera.get_world();
+  new_world += point2d(-dx / scale.x, -dy / scale.y);
+  m_camera.set_world(new_world);
+
+  double const w = width();
+  double const h = height();
+
+  // Nothing that was shown is still on screen
+  if(std::abs(dx) >= w || std::abs(dy) >= h) {
+    redraw();
+    return;
+  }
+
+  // The uncovered strips: one along the left or right edge, and one along the top or bottom edge beside it
+  std::vector<rectangle> strips;
+  if(dx != 0)
+    strips.push_back(dx > 0 ? rectangle({0, 0}, {dx, h}) : rectangle({w + dx, 0}, {w, h}));
+  if(dy != 0) {
+    double const left = std::max(dx, 0.0);
+    double const right = std::min(w + dx, w);
+    strips.push_back(dy > 0 ? rectangle({left, 0}, {right, dy}) : rectangle({left, h + dy}, {right, h}));
+  }
+
+  if(!caches_layers()) {
+    // The off-screen surface is the only drawing; treat it as the base layer
+    layer shown = {BASE_LAYER, m_layers[0].draw_callback, m_surface, m_context};
+    shift_surface(m_surface, m_context, (int)dx, (int)dy);
+    for(rectangle const &strip : strips)
+      draw_layer(shown, true, &strip);
+  } else {
+    for(size_t i = 0; i < m_layers.size(); ++i) {
+      shift_surface(m_layers[i].surface, m_layers[i].context, (int)dx, (int)dy);
+      for(rectangle const &strip : strips)
+        draw_layer(m_layers[i], i == 0, &strip);
+    }
+
+    composite(nullptr);
+  }
+
+  gtk_widget_queue_draw(m_drawing_area);
+}
+
+void canvas::shift_surface(cairo_surface_t *surface, cairo_t *context, int dx, int dy)
+{
+  if(m_scratch_surface == nullptr)
+    m_scratch_surface = create_surface(m_drawing_area);
+
+  // A surface cannot be painted onto itself, so copy it aside first
+  cairo_t *scratch_context = cairo_create(m_scratch_surface);
+  cairo_set_operator(scratch_context, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(scratch_context, surface, 0, 0);
+  cairo_paint(scratch_context);
+  cairo_destroy(scratch_context);
+
+  // Copying (rather than blending) it back also makes the uncovered part transparent
+  cairo_save(context);
+  cairo_set_operator(context, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(context, m_scratch_surface, dx, dy);
+  cairo_paint(context);
+  cairo_restore(context);
+}
+
+bool canvas::caches_layers() const
+{
+  return m_overlay_callback != nullptr || m_layers.size() > 1;
+}
+
+void canvas::update_layer_surfaces()
+{
+  for(layer &cached_layer : m_layers) {
+    if(cached_layer.surface != nullptr) {
+      cairo_surface_destroy(cached_layer.surface);
+      cached_layer.surface = nullptr;
+    }
+
+    if(cached_layer.context != nullptr) {
+      cairo_destroy(cached_layer.context);
+      cached_layer.context = nullptr;
+    }
+
+    if(caches_layers()) {
+      cached_layer.surface = create_surface(m_drawing_area);
+      cached_layer.context = create_context(cached_layer.surface);
+    }
+  }
+}
+
+void canvas::draw_layer(layer &cached_layer, bool is_base, rectangle const *region)
+{
+  cairo_save(cached_layer.context);
+
+  {
+    renderer g(cached_layer.context, [this](point2d world) { return m_camera.world_to_screen(world); }, &m_camera,
+        cached_layer.surface);
+    // Outside the region the layer keeps what it has
+    if(region != nullptr)
+      g.set_clip_region(*region, PAN_STRIP_PADDING);
+
+    if(is_base) {
+      // The base layer is opaque, starting from the background color
+      cairo_set_source_rgb(cached_layer.context, m_background_color.red / 255.0, m_background_color.green / 255.0,
+          m_background_color.blue / 255.0);
+      cairo_paint(cached_layer.context);
+    } else {
+      // Every other layer starts out transparent, so the layers under it show through
+      cairo_set_operator(cached_layer.context, CAIRO_OPERATOR_CLEAR);
+      cairo_paint(cached_layer.context);
+      cairo_set_operator(cached_layer.context, CAIRO_OPERATOR_OVER);
+    }
+
+    cached_layer.draw_callback(&g);
+  }
+
+  cairo_restore(cached_layer.context);
+}
+
+void canvas::composite(rectangle const *region)
+{
+  cairo_save(m_context);
+
+  {
+    renderer g(m_context, [this](point2d world) { return m_camera.world_to_screen(world); }, &m_camera, m_surface);
+    if(region != nullptr)
+      g.set_clip_region(*region);
+
+    // Stack the cached layers, which also erases the previous overlay
+    for(layer const &cached_layer : m_layers) {
+      cairo_set_source_surface(m_context, cached_layer.surface, 0, 0);
+      cairo_paint(m_context);
+    }
+
+    if(m_overlay_callback != nullptr)
+      m_overlay_callback(&g);
+  }
+
+  cairo_restore(m_context);
 }
 
 renderer *canvas::create_animation_renderer()
 {
   if(m_animation_renderer == nullptr) {
-    using namespace std::placeholders;
-    m_animation_renderer = new renderer(m_context, std::bind(&camera::world_to_screen, &m_camera, _1), &m_camera, m_surface);
+      m_animation_renderer = new renderer(
+        m_context, [this](point2d world) { return m_camera.world_to_screen(world); }, &m_camera, m_surface);
   }
 
   return m_animation_renderer;
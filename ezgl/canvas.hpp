@@ -30,6 +30,7 @@
 #include <gtk/gtk.h>
 
 #include <string>
+#include <vector>
 
 namespace ezgl {
 
@@ -42,6 +43,11 @@ class renderer;
  */
 using draw_canvas_fn = void (*)(renderer*);
 
+/**
+ * The name of the bottom layer of every canvas, the one drawn by the draw callback the canvas is created with.
+ */
+#define BASE_LAYER "base"
+
 /**
  * Responsible for creating, destroying, and maintaining the rendering context of a GtkWidget.
  *
@@ -50,6 +56,8 @@ using draw_canvas_fn = void (*)(renderer*);
  *
  * Each canvas is double-buffered. A draw callback (see: ezgl::draw_canvas_fn) is invoked each time the canvas needs to
  * be redrawn. This may be caused by the user (e.g., resizing the screen), but can also be forced by the programmer.
+ * Further layers (see: add_layer) and an overlay (see: set_overlay_callback) can be drawn over it and redrawn on their
+ * own.
  */
 class canvas {
 public:
@@ -83,6 +91,85 @@ public:
    */
   void redraw();
 
+  /**
+   * Add a layer to the canvas, drawn over the layers added before it and under the overlay.
+   *
+   * Once a canvas has more than one layer (or an overlay), each layer is drawn to a cached surface of its own and the
+   * surfaces are composited to show the canvas. A layer can then be redrawn with redraw_layer() without calling the
+   * draw functions of the others. If a layer with the same name exists, it is not replaced and a warning is displayed.
+   *
+   * @param name The name to refer to the layer by.
+   * @param draw_callback The function that draws the layer.
+   */
+  void add_layer(std::string const &name, draw_canvas_fn draw_callback);
+
+  /**
+   * Redraw one layer, reusing the cached drawing of all the others, and queue a redraw of the GtkWidget.
+   *
+   * Useful when something only one layer shows has changed. Without cached layers this is the same as redraw().
+   *
+   * @param name The name of the layer, BASE_LAYER for the one drawn by the canvas' draw callback.
+   */
+  void redraw_layer(std::string const &name);
+
+  /**
+   * Set the function that draws the overlay of the canvas: content such as highlights that changes without the rest
+   * of the drawing changing.
+   *
+   * Once set, the layers are kept in cached surfaces and the overlay is drawn over a copy of them, so invalidate() can
+   * redraw a part of the overlay without calling any layer's draw callback.
+   *
+   * @param overlay_callback The function that draws the overlay, or nullptr to draw everything in the draw callback.
+   */
+  void set_overlay_callback(draw_canvas_fn overlay_callback);
+
+  /**
+   * Redraw the overlay inside a region of the world over the cached layers, and queue a redraw of only that part of
+   * the GtkWidget.
+   *
+   * Without an overlay callback this is the same as redraw().
+   *
+   * @param world_region The region that changed, in world coordinates.
+   * @param padding Pixels to add on every side of the region, e.g. for line widths and text that extend past the
+   *                world coordinates of what changed.
+   */
+  void invalidate(rectangle world_region, double padding = 0);
+
+  /**
+   * Redraw the whole overlay over the cached layers without calling any layer's draw callback.
+   *
+   * Without an overlay callback this is the same as redraw().
+   */
+  void invalidate();
+
+  /**
+   * Move the view to a new world rectangle over the next few frames instead of at once.
+   *
+   * While the view moves, the last drawing is scaled and translated to follow it, without calling any draw callback;
+   * the canvas is redrawn once, when the view reaches the target. Calling this again before then sets a new target
+   * and continues from the view shown at that moment, so a quick series of changes (e.g. wheel zooms) costs one
+   * redraw. Any other redraw ends the animation where the camera is at that time.
+   *
+   * @param target_world The region of the world to show at the end of the animation.
+   */
+  void animate_to_world(rectangle target_world);
+
+  /**
+   * Get the world rectangle the view is animating to, or the camera's world if it is not animating.
+   */
+  rectangle get_target_world() const;
+
+  /**
+   * Pan the view by a number of pixels on the next frame.
+   *
+   * Pans requested before the next frame add up and are applied together: the cached drawing is shifted by the
+   * whole-pixel offset and the draw callbacks only draw the strips it uncovers. The overlay is redrawn in full.
+   *
+   * @param dx Pixels to move the drawing to the right.
+   * @param dy Pixels to move the drawing down.
+   */
+  void pan(double dx, double dy);
+
   /**
    * Get an immutable reference to this canvas' camera.
    */
@@ -138,9 +225,6 @@ private:
   // Name of the canvas in XML.
   std::string m_canvas_id;
 
-  // The function to call when the widget needs to be redrawn.
-  draw_canvas_fn m_draw_callback;
-
   // The transformations between the GUI and the world.
   camera m_camera;
 
@@ -159,7 +243,73 @@ private:
   // The animation renderer
   renderer *m_animation_renderer = nullptr;
 
+  // A layer of the drawing and its cached surface (only used when the canvas caches its layers).
+  struct layer {
+    std::string name;
+    draw_canvas_fn draw_callback;
+    cairo_surface_t *surface = nullptr;
+    cairo_t *context = nullptr;
+  };
+
+  // The layers from the bottom up; the first is the BASE_LAYER, drawn by the canvas' draw callback.
+  std::vector<layer> m_layers;
+
+  // The function to call to draw the overlay, if any.
+  draw_canvas_fn m_overlay_callback = nullptr;
+
+  // The drawing shown when the current view animation started, and its world to screen mapping.
+  cairo_surface_t *m_animation_snapshot = nullptr;
+  point2d m_snapshot_scale = {1.0, -1.0};
+  point2d m_snapshot_offset = {0.0, 0.0};
+
+  // The world the view animation moves from and to, and its start time in frame clock microseconds (-1 until the
+  // first frame after the target was set).
+  rectangle m_animation_start_world;
+  rectangle m_animation_target_world;
+  gint64 m_animation_start_time = -1;
+
+  // The frame clock callback driving the view animation, 0 when the view is not animating.
+  guint m_animation_tick_id = 0;
+
+  // The pixels the view still has to be panned by, and the frame clock callback that will do it (0 if none is due).
+  point2d m_pending_pan = {0.0, 0.0};
+  guint m_pan_tick_id = 0;
+
+  // A surface the size of the drawing area to copy a surface aside while shifting it, created on the first pan.
+  cairo_surface_t *m_scratch_surface = nullptr;
+
 private:
+  // True if each layer is drawn to its own surface, i.e. there is more than one layer or an overlay.
+  bool caches_layers() const;
+
+  // (Re)create the layer surfaces at the size of the drawing area, or free them when layers are not cached.
+  void update_layer_surfaces();
+
+  // Draw a layer to its cached surface, only inside region (in pixels) if it is not null.
+  void draw_layer(layer &cached_layer, bool is_base, rectangle const *region);
+
+  // Composite the cached layers to the off-screen surface and draw the overlay over them, only inside region (in
+  // pixels) if it is not null.
+  void composite(rectangle const *region);
+
+  // Stop the view animation, leaving the camera where it is, and free its snapshot.
+  void stop_animation();
+
+  // Show the animation snapshot moved and scaled to the camera's current world.
+  void draw_animation_frame();
+
+  // Called on every frame while the view is animating.
+  static gboolean animation_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+
+  // Apply the pending pan: shift the drawing by its whole pixels and draw the uncovered strips.
+  void apply_pan();
+
+  // Move the content of a surface by (dx, dy) pixels, leaving the uncovered part transparent.
+  void shift_surface(cairo_surface_t *surface, cairo_t *context, int dx, int dy);
+
+  // Called on the frame after a pan is requested.
+  static gboolean pan_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+
   // Called each time our drawing area widget has changed (e.g., in size).
   static gboolean configure_event(GtkWidget *widget, GdkEventConfigure *event, gpointer data);
 
@@ -45,6 +45,19 @@ static rectangle zoom_out_world(point2d zoom_point, rectangle world, double zoom
   return {{left, bottom}, {right, top}};
 }
 
+// The world point a widget point will show once the view reaches the target world, which differs from the camera's
+// world while the view is animating.
+static point2d widget_to_target_world(canvas *cnv, point2d widget_point, rectangle target_world)
+{
+  point2d const world_point = cnv->get_camera().widget_to_world(widget_point);
+  rectangle const world = cnv->get_camera().get_world();
+
+  double const x = target_world.left() + (world_point.x - world.left()) / world.width() * target_world.width();
+  double const y = target_world.bottom() + (world_point.y - world.bottom()) / world.height() * target_world.height();
+
+  return {x, y};
+}
+
 void zoom_in(canvas *cnv, double zoom_factor)
 {
   point2d const zoom_point = cnv->get_camera().get_world().center();
@@ -81,6 +94,22 @@ void zoom_out(canvas *cnv, point2d zoom_point, double zoom_factor)
   cnv->redraw();
 }
 
+void animated_zoom_in(canvas *cnv, point2d zoom_point, double zoom_factor)
+{
+  rectangle const world = cnv->get_target_world();
+  zoom_point = widget_to_target_world(cnv, zoom_point, world);
+
+  cnv->animate_to_world(zoom_in_world(zoom_point, world, zoom_factor));
+}
+
+void animated_zoom_out(canvas *cnv, point2d zoom_point, double zoom_factor)
+{
+  rectangle const world = cnv->get_target_world();
+  zoom_point = widget_to_target_world(cnv, zoom_point, world);
+
+  cnv->animate_to_world(zoom_out_world(zoom_point, world, zoom_factor));
+}
+
 void zoom_fit(canvas *cnv, rectangle region)
 {
   cnv->get_camera().set_world(region);
@@ -49,6 +49,20 @@ void zoom_in(canvas *cnv, point2d zoom_point, double zoom_factor);
  */
 void zoom_out(canvas *cnv, point2d zoom_point, double zoom_factor);
 
+/**
+ * Zoom in on a specific point in the GTK widget over the next few frames (see canvas::animate_to_world).
+ *
+ * Zooms that arrive while the view is still animating add up: each one zooms from the view being animated to.
+ */
+void animated_zoom_in(canvas *cnv, point2d zoom_point, double zoom_factor);
+
+/**
+ * Zoom out from a specific point in the GTK widget over the next few frames (see canvas::animate_to_world).
+ *
+ * Zooms that arrive while the view is still animating add up: each one zooms from the view being animated to.
+ */
+void animated_zoom_out(canvas *cnv, point2d zoom_point, double zoom_factor);
+
 /**
  * Zoom in or out to fit an exact region of the world.
  */
@@ -20,9 +20,132 @@
 
 #include <cassert>
 #include <glib.h>
+#include <list>
+#include <string_view>
+#include <unordered_map>
 
 namespace ezgl {
 
+namespace {
+
+// Number of strings the text cache holds unless set_text_cache_size changes it
+constexpr std::size_t DEFAULT_TEXT_CACHE_SIZE = 4096;
+
+// Number of times a string is drawn before it is pre-rendered, so one-off text is never rendered twice
+constexpr int TEXT_PRERENDER_MIN_USES = 3;
+
+// Empty pixels around the text in a pre-rendered surface, so antialiased edges are not cut off
+constexpr int TEXT_PRERENDER_PADDING = 1;
+
+/**
+ * Measurements, and optionally a pre-rendered surface, of recently drawn strings, evicting the least recently used.
+ *
+ * ezgl only draws from the GTK main thread, so the cache is shared by all renderers without locking.
+ */
+class text_cache {
+public:
+  struct entry {
+    std::string key;
+    cairo_text_extents_t text_extents;
+    cairo_font_extents_t font_extents;
+    int uses = 0;
+    // the text rendered in surface_color, or nullptr
+    cairo_surface_t *surface = nullptr;
+    color surface_color;
+  };
+
+  ~text_cache()
+  {
+    resize(0);
+  }
+
+  // the entry for a key, marked as most recently used; nullptr if it is not cached
+  entry *find(std::string const &key)
+  {
+    auto it = index.find(key);
+    if(it == index.end())
+      return nullptr;
+
+    entries.splice(entries.begin(), entries, it->second);
+    return &*it->second;
+  }
+
+  // a new entry for a key that is not cached; nullptr if the cache is off
+  entry *insert(std::string key)
+  {
+    if(max_entries == 0)
+      return nullptr;
+
+    evict_to(max_entries - 1);
+    entries.emplace_front();
+    entries.front().key = std::move(key);
+    index.emplace(entries.front().key, entries.begin());
+    return &entries.front();
+  }
+
+  void resize(std::size_t new_max_entries)
+  {
+    max_entries = new_max_entries;
+    evict_to(max_entries);
+  }
+
+  bool prerender = false;
+
+private:
+  void evict_to(std::size_t size)
+  {
+    while(entries.size() > size) {
+      index.erase(entries.back().key);
+      if(entries.back().surface != nullptr)
+        cairo_surface_destroy(entries.back().surface);
+      entries.pop_back();
+    }
+  }
+
+  std::size_t max_entries = DEFAULT_TEXT_CACHE_SIZE;
+  std::list<entry> entries;
+  // keys point into the entries' own strings, which list nodes never move
+  std::unordered_map<std::string_view, std::list<entry>::iterator> index;
+};
+
+text_cache &get_text_cache()
+{
+  static text_cache cache;
+  return cache;
+}
+
+// Renders text into a new surface just big enough for it, with its glyph box offset by the padding
+cairo_surface_t *prerender_text(cairo_t *context, std::string const &text, cairo_text_extents_t const &extents, color c)
+{
+  int width = static_cast<int>(std::ceil(extents.width)) + 2 * TEXT_PRERENDER_PADDING;
+  int height = static_cast<int>(std::ceil(extents.height)) + 2 * TEXT_PRERENDER_PADDING;
+  cairo_surface_t *text_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+
+  cairo_matrix_t font_matrix;
+  cairo_get_font_matrix(context, &font_matrix);
+
+  cairo_t *text_context = cairo_create(text_surface);
+  cairo_set_font_face(text_context, cairo_get_font_face(context));
+  cairo_set_font_matrix(text_context, &font_matrix);
+  cairo_set_source_rgba(text_context, c.red / 255.0, c.green / 255.0, c.blue / 255.0, c.alpha / 255.0);
+  cairo_move_to(text_context, TEXT_PRERENDER_PADDING - extents.x_bearing, TEXT_PRERENDER_PADDING - extents.y_bearing);
+  cairo_show_text(text_context, text.c_str());
+  cairo_destroy(text_context);
+
+  return text_surface;
+}
+}
+
+void renderer::set_text_cache_size(std::size_t max_entries)
+{
+  get_text_cache().resize(max_entries);
+}
+
+void renderer::set_text_prerender(bool enable)
+{
+  get_text_cache().prerender = enable;
+}
+
 renderer::renderer(cairo_t *cairo,
     transform_fn transform,
     camera *p_camera,
@@ -61,6 +184,10 @@ void renderer::update_renderer(cairo_t *cairo, cairo_surface_t *m_surface)
   // Update Cairo Context
   m_cairo = cairo;
 
+  // A new context starts with cairo's default font
+  font_face_known = false;
+  font_size_known = false;
+
   // Update X11 Context
 #ifdef EZGL_USE_X11
   // Check if the created cairo surface is an XLIB surface
@@ -86,6 +213,26 @@ void renderer::update_renderer(cairo_t *cairo, cairo_surface_t *m_surface)
   set_line_dash(current_line_dash);
 }
 
+void renderer::set_clip_region(rectangle region, double padding)
+{
+  cairo_rectangle(m_cairo, region.left(), region.bottom(), region.width(), region.height());
+  cairo_clip(m_cairo);
+
+#ifdef EZGL_USE_X11
+  // X11 draw calls do not go through cairo, so they need the same clip on their own context
+  if (x11_display != nullptr) {
+    XRectangle x11_region = {(short)region.left(), (short)region.bottom(), (unsigned short)region.width(),
+        (unsigned short)region.height()};
+    XSetClipRectangles(x11_display, x11_context, 0, 0, &x11_region, 1, Unsorted);
+  }
+#endif
+
+  has_clip_region = true;
+  point2d const margin = {padding, padding};
+  clip_world = {m_camera->widget_to_world(region.bottom_left() - margin),
+      m_camera->widget_to_world(region.top_right() + margin)};
+}
+
 void renderer::set_coordinate_system(t_coordinate_system new_coordinate_system)
 {
   current_coordinate_system = new_coordinate_system;
@@ -143,6 +290,11 @@ rectangle renderer::get_visible_screen()
   return m_camera->get_widget();
 }
 
+rectangle renderer::get_clip_world()
+{
+  return has_clip_region ? clip_world : get_visible_world();
+}
+
 rectangle renderer::world_to_screen(const rectangle& box)
 {
   point2d origin = m_transform(box.bottom_left());
@@ -156,7 +308,7 @@ bool renderer::rectangle_off_screen(rectangle rect)
   if(current_coordinate_system == SCREEN)
     return false;
 
-  rectangle visible = get_visible_world();
+  rectangle visible = get_clip_world();
 
   if(rect.right() < visible.left())
     return true;
@@ -213,6 +365,11 @@ void renderer::set_color(uint_fast8_t red,
 #endif
 }
 
+color renderer::get_color() const
+{
+  return current_color;
+}
+
 void renderer::set_line_cap(line_cap cap)
 {
   auto cairo_cap = static_cast<cairo_line_cap_t>(cap);
@@ -270,13 +427,26 @@ void renderer::set_line_width(int width)
 
 void renderer::set_font_size(double new_size)
 {
+  if(font_size_known && new_size == current_font_size)
+    return;
+
   cairo_set_font_size(m_cairo, new_size);
+  current_font_size = new_size;
+  font_size_known = true;
 }
 
 void renderer::format_font(std::string const &family, font_slant slant, font_weight weight)
 {
+  if(font_face_known && family == current_font_family && slant == current_font_slant &&
+      weight == current_font_weight)
+    return;
+
   cairo_select_font_face(m_cairo, family.c_str(), static_cast<cairo_font_slant_t>(slant),
       static_cast<cairo_font_weight_t>(weight));
+  current_font_family = family;
+  current_font_slant = slant;
+  current_font_weight = weight;
+  font_face_known = true;
 }
 
 void renderer::format_font(std::string const &family,
@@ -339,6 +509,87 @@ void renderer::draw_line(point2d start, point2d end)
   cairo_stroke(m_cairo);
 }
 
+point2d const *renderer::transform_points(point2d const *points, size_t count)
+{
+  if(current_coordinate_system == SCREEN)
+    return points;
+
+  if(m_transformed_points.size() < count)
+    m_transformed_points.resize(count);
+
+  // The canvas binds m_transform to this same camera, so the bulk path gives the same points without a call each
+  if(m_camera != nullptr) {
+    m_camera->world_to_screen(points, m_transformed_points.data(), count);
+  } else {
+    for(size_t i = 0; i < count; ++i)
+      m_transformed_points[i] = m_transform(points[i]);
+  }
+  return m_transformed_points.data();
+}
+
+bool renderer::append_polyline_path(point2d const *points, size_t count)
+{
+  if(count < 2)
+    return false;
+
+  double x_min = points[0].x, x_max = points[0].x;
+  double y_min = points[0].y, y_max = points[0].y;
+  for(size_t i = 1; i < count; ++i) {
+    x_min = std::min(x_min, points[i].x);
+    x_max = std::max(x_max, points[i].x);
+    y_min = std::min(y_min, points[i].y);
+    y_max = std::max(y_max, points[i].y);
+  }
+  if(rectangle_off_screen({{x_min, y_min}, {x_max, y_max}}))
+    return false;
+
+  point2d const *screen_points = transform_points(points, count);
+
+  cairo_move_to(m_cairo, screen_points[0].x, screen_points[0].y);
+  for(size_t i = 1; i < count; ++i)
+    cairo_line_to(m_cairo, screen_points[i].x, screen_points[i].y);
+  return true;
+}
+
+void renderer::stroke_polyline_path()
+{
+  // separate round-capped segments overlap in round joints, so keep that look for the joined path
+  cairo_line_join_t previous_join = cairo_get_line_join(m_cairo);
+  if(current_line_cap == line_cap::round)
+    cairo_set_line_join(m_cairo, CAIRO_LINE_JOIN_ROUND);
+
+  cairo_stroke(m_cairo);
+
+  cairo_set_line_join(m_cairo, previous_join);
+}
+
+void renderer::draw_polyline(point2d const *points, size_t count)
+{
+  draw_polylines(points, &count, 1);
+}
+
+void renderer::draw_polylines(point2d const *points, size_t const *sizes, size_t num_polylines)
+{
+#ifdef EZGL_USE_X11
+  if(!transparency_flag && x11_display != nullptr) {
+    for(size_t line = 0; line < num_polylines; points += sizes[line], ++line) {
+      for(size_t i = 1; i < sizes[line]; ++i)
+        draw_line(points[i - 1], points[i]);
+    }
+    return;
+  }
+#endif
+
+  bool any_on_screen = false;
+  for(size_t line = 0; line < num_polylines; points += sizes[line], ++line) {
+    if(append_polyline_path(points, sizes[line]))
+      any_on_screen = true;
+  }
+
+  if(any_on_screen)
+    stroke_polyline_path();
+}
+
 void renderer::draw_rectangle(point2d start, point2d end)
 {
   if(rectangle_off_screen({start, end}))
@@ -411,7 +662,7 @@ void renderer::fill_poly(std::vector<point2d> const &points)
   if(rectangle_off_screen({{x_min, y_min}, {x_max, y_max}}))
     return;
 
-  point2d next_point = points[0];
+  point2d const *screen_points = transform_points(points.data(), points.size());
 
 #ifdef EZGL_USE_X11
   if(!transparency_flag && x11_display != nullptr) {
@@ -423,12 +674,8 @@ void renderer::fill_poly(std::vector<point2d> const &points)
     }
 
     for(size_t i = 0; i < points.size(); i++) {
-      if(current_coordinate_system == WORLD)
-        next_point = m_transform(points[i]);
-      else
-        next_point = points[i];
-      trans_points[i].x = static_cast<long>(next_point.x);
-      trans_points[i].y = static_cast<long>(next_point.y);
+      trans_points[i].x = static_cast<long>(screen_points[i].x);
+      trans_points[i].y = static_cast<long>(screen_points[i].y);
     }
 
     XFillPolygon(x11_display, x11_drawable, x11_context, trans_points, points.size(), Complex,
@@ -440,18 +687,10 @@ void renderer::fill_poly(std::vector<point2d> const &points)
   }
 #endif
 
-  if(current_coordinate_system == WORLD)
-    next_point = m_transform(points[0]);
+  cairo_move_to(m_cairo, screen_points[0].x, screen_points[0].y);
 
-  cairo_move_to(m_cairo, next_point.x, next_point.y);
-
-  for(std::size_t i = 1; i < points.size(); ++i) {
-    if(current_coordinate_system == WORLD)
-      next_point = m_transform(points[i]);
-    else
-      next_point = points[i];
-    cairo_line_to(m_cairo, next_point.x, next_point.y);
-  }
+  for(std::size_t i = 1; i < points.size(); ++i)
+    cairo_line_to(m_cairo, screen_points[i].x, screen_points[i].y);
 
   cairo_close_path(m_cairo);
   cairo_fill(m_cairo);
@@ -531,13 +770,33 @@ void renderer::draw_text(point2d point, std::string const &text, double bound_x,
   if(rectangle_off_screen({{center.x - bound_x / 2, center.y - bound_y / 2}, bound_x, bound_y}))
     return;
 
+  // look the text up in the text cache, which needs to know the font it is drawn in
+  text_cache::entry *cached = nullptr;
+  if(font_face_known && font_size_known) {
+    std::string key = current_font_family + '\n' + std::to_string(static_cast<int>(current_font_slant)) + ' ' +
+                      std::to_string(static_cast<int>(current_font_weight)) + ' ' +
+                      std::to_string(current_font_size) + '\n' + text;
+    cached = get_text_cache().find(key);
+    if(cached == nullptr) {
+      cached = get_text_cache().insert(std::move(key));
+      if(cached != nullptr) {
+        cairo_text_extents(m_cairo, text.c_str(), &cached->text_extents);
+        cairo_font_extents(m_cairo, &cached->font_extents);
+      }
+    }
+  }
+
   // get the width and height of the drawn text
   cairo_text_extents_t text_extents{0,0,0,0,0,0};
-  cairo_text_extents(m_cairo, text.c_str(), &text_extents);
-
   // get more information about the font used
   cairo_font_extents_t font_extents{0,0,0,0,0};
-  cairo_font_extents(m_cairo, &font_extents);
+  if(cached != nullptr) {
+    text_extents = cached->text_extents;
+    font_extents = cached->font_extents;
+  } else {
+    cairo_text_extents(m_cairo, text.c_str(), &text_extents);
+    cairo_font_extents(m_cairo, &font_extents);
+  }
 
   // get text width and height in the current coordinate system to check against the bounds
   // Note: text width and height are constant in widget coordinates
@@ -595,10 +854,31 @@ void renderer::draw_text(point2d point, std::string const &text, double bound_x,
     ref_point.y -= (text_extents.height / 2) * cos(rotation_angle);
   }
 
-  // move to the reference point, perform the rotation, and draw the text
-  cairo_move_to(m_cairo, ref_point.x, ref_point.y);
-  cairo_rotate(m_cairo, rotation_angle);
-  cairo_show_text(m_cairo, text.c_str());
+  // pre-render text that keeps being drawn, once per color
+  cairo_surface_t *prerendered = nullptr;
+  if(cached != nullptr && get_text_cache().prerender && ++cached->uses >= TEXT_PRERENDER_MIN_USES) {
+    if(cached->surface == nullptr || cached->surface_color != current_color) {
+      if(cached->surface != nullptr)
+        cairo_surface_destroy(cached->surface);
+      cached->surface = prerender_text(m_cairo, text, text_extents, current_color);
+      cached->surface_color = current_color;
+    }
+    prerendered = cached->surface;
+  }
+
+  if(prerendered != nullptr) {
+    // the surface's top left corner is the glyph box's, less the padding, relative to the reference point
+    cairo_translate(m_cairo, ref_point.x, ref_point.y);
+    cairo_rotate(m_cairo, rotation_angle);
+    cairo_set_source_surface(m_cairo, prerendered, text_extents.x_bearing - TEXT_PRERENDER_PADDING,
+        text_extents.y_bearing - TEXT_PRERENDER_PADDING);
+    cairo_paint(m_cairo);
+  } else {
+    // move to the reference point, perform the rotation, and draw the text
+    cairo_move_to(m_cairo, ref_point.x, ref_point.y);
+    cairo_rotate(m_cairo, rotation_angle);
+    cairo_show_text(m_cairo, text.c_str());
+  }
 
   // restore the old state to undo the performed rotation
   cairo_restore(m_cairo);
@@ -720,6 +1000,14 @@ void renderer::draw_arc_path(point2d center,
 }
 
 void renderer::draw_surface(surface *p_surface, point2d point, double scale_factor)
+{
+  rectangle whole_surface = {{0, 0}, (double)cairo_image_surface_get_width(p_surface),
+      (double)cairo_image_surface_get_height(p_surface)};
+
+  draw_surface_region(p_surface, whole_surface, point, scale_factor);
+}
+
+void renderer::draw_surface_region(surface *p_surface, rectangle region, point2d point, double scale_factor)
 {
   // Check if the surface is properly created
   if(cairo_surface_status(p_surface) != CAIRO_STATUS_SUCCESS) {
@@ -727,11 +1015,11 @@ void renderer::draw_surface(surface *p_surface, point2d point, double scale_fact
     return;
   }
 
-  // calculate surface width and height in screen coordinates
-  double s_width = (double)cairo_image_surface_get_width(p_surface) * scale_factor;
-  double s_height = (double)cairo_image_surface_get_height(p_surface) * scale_factor;
+  // calculate region width and height in screen coordinates
+  double s_width = region.width() * scale_factor;
+  double s_height = region.height() * scale_factor;
 
-  // calculate surface width and height in world coordinates
+  // calculate region width and height in world coordinates
   if (current_coordinate_system == WORLD) {
     s_width *= m_camera->get_world_scale_factor().x;
     s_height *= m_camera->get_world_scale_factor().y;
@@ -758,10 +1046,17 @@ void renderer::draw_surface(surface *p_surface, point2d point, double scale_fact
   if(current_coordinate_system == WORLD)
     top_left = m_transform(top_left);
 
-  if (scale_factor != 1) {
-    // save the current state to undo the scaling
+  // only part of the surface needs a clip, so drawing a whole surface stays as cheap as before
+  bool whole_surface = region.left() == 0 && region.bottom() == 0 &&
+                       region.width() == cairo_image_surface_get_width(p_surface) &&
+                       region.height() == cairo_image_surface_get_height(p_surface);
+
+  if (scale_factor != 1 || !whole_surface) {
+    // save the current state to undo the scaling and clipping
     cairo_save(m_cairo);
+  }
 
+  if (scale_factor != 1) {
     // scale the cairo context with the given scale factor
     cairo_scale(m_cairo, scale_factor, scale_factor);
 
@@ -770,18 +1065,52 @@ void renderer::draw_surface(surface *p_surface, point2d point, double scale_fact
     top_left.y /= scale_factor;
   }
 
-  // Create a source for painting from the surface
-  cairo_set_source_surface(m_cairo, p_surface, top_left.x, top_left.y);
+  if (!whole_surface) {
+    // keep the rest of the surface from being painted
+    cairo_rectangle(m_cairo, top_left.x, top_left.y, region.width(), region.height());
+    cairo_clip(m_cairo);
+  }
+
+  // Create a source for painting from the surface, with the region's corner at the top left point
+  cairo_set_source_surface(m_cairo, p_surface, top_left.x - region.left(), top_left.y - region.bottom());
 
   // Actual drawing
   cairo_paint(m_cairo);
 
-  if (scale_factor != 1) {
-    // restore the old state to undo the performed scaling
+  if (scale_factor != 1 || !whole_surface) {
+    // restore the old state to undo the performed scaling and clipping
     cairo_restore(m_cairo);
   }
 }
 
+surface *renderer::pack_surfaces(std::vector<surface *> const &surfaces, std::vector<rectangle> &regions)
+{
+  // one row, each surface to the right of the previous one
+  regions.clear();
+  double atlas_width = 0;
+  double atlas_height = 0;
+  for(surface *p_surface : surfaces) {
+    double width = cairo_image_surface_get_width(p_surface);
+    double height = cairo_image_surface_get_height(p_surface);
+    regions.push_back({{atlas_width, 0}, width, height});
+    atlas_width += width;
+    atlas_height = std::max(atlas_height, height);
+  }
+
+  cairo_surface_t *atlas = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, std::max(1, (int)atlas_width),
+      std::max(1, (int)atlas_height));
+  cairo_t *atlas_context = cairo_create(atlas);
+  for(std::size_t i = 0; i < surfaces.size(); ++i) {
+    if(cairo_surface_status(surfaces[i]) != CAIRO_STATUS_SUCCESS)
+      continue;
+    cairo_set_source_surface(atlas_context, surfaces[i], regions[i].left(), 0);
+    cairo_paint(atlas_context);
+  }
+  cairo_destroy(atlas_context);
+
+  return atlas;
+}
+
 surface *renderer::load_png(const char *file_path)
 {
   // Create an image surface from a PNG image
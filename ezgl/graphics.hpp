@@ -205,6 +205,13 @@ public:
    */
   rectangle get_visible_screen();
 
+  /**
+   * Get the world area that draw calls can still reach
+   *
+   * @return The world area of the clip region if one is set, otherwise the visible world
+   */
+  rectangle get_clip_world();
+
   /**
    * Get the screen coordinates (pixel locations) of the world coordinate rectangle box
    * 
@@ -241,6 +248,13 @@ public:
    */
   void set_color(uint_fast8_t red, uint_fast8_t green, uint_fast8_t blue, uint_fast8_t alpha = 255);
 
+  /**
+   * Get the color used by subsequent draw calls.
+   *
+   * @return The color last set with set_color.
+   */
+  color get_color() const;
+
   /**
    * Change how line endpoints will be rendered in subsequent draw calls. 
    * 
@@ -300,6 +314,27 @@ public:
    */
   void set_text_rotation(double degrees);
 
+  /**
+   * Set how many strings draw_text keeps measurements for.
+   *
+   * draw_text remembers the cairo text and font extents of recently drawn strings, keyed by font family, slant,
+   * weight, size and text, and drops the least recently used ones beyond this many. 0 turns the cache off.
+   *
+   * @param max_entries The largest number of strings to remember.
+   */
+  static void set_text_cache_size(std::size_t max_entries);
+
+  /**
+   * Pre-render frequently drawn text to small surfaces.
+   *
+   * When enabled, a string that draw_text has drawn a few times with the same font and color is rendered once to
+   * a bitmap kept with its cached measurements, and later draws paint that bitmap instead of shaping the glyphs
+   * again. Off by default: bitmaps do not scale, so it only suits labels drawn at a fixed font size.
+   *
+   * @param enable Whether to pre-render text.
+   */
+  static void set_text_prerender(bool enable);
+
   /**
    * set horizontal justification; used for text and surfaces. 
    *
@@ -324,6 +359,25 @@ public:
    */
   void draw_line(point2d start, point2d end);
 
+  /**
+   * Draw a connected line through a sequence of points. The whole line is built as one path and stroked once,
+   * which is much cheaper than a draw_line call per pair of points.
+   *
+   * @param points The points of the line, in the current coordinate system
+   * @param count The number of points; fewer than two draws nothing
+   */
+  void draw_polyline(point2d const *points, size_t count);
+
+  /**
+   * Draw many polylines with the current color, width, cap and dash, all in one path and one stroke.
+   * Polylines whose bounding box is off screen are skipped.
+   *
+   * @param points The points of every polyline, one polyline after the other, in the current coordinate system
+   * @param sizes The number of points in each polyline
+   * @param num_polylines The number of polylines
+   */
+  void draw_polylines(point2d const *points, size_t const *sizes, size_t num_polylines);
+
   /**
    * Draw the outline a rectangle.
    *
@@ -464,6 +518,29 @@ public:
    */
   void draw_surface(surface *p_surface, point2d anchor_point, double scale_factor = 1);
 
+  /**
+   * Draw part of a surface, such as one image of an atlas made by pack_surfaces
+   *
+   * @param surface The surface (bitmap) to draw from
+   * @param region The part of the surface to draw, in the surface's pixels with the y-axis pointing down:
+   *           {{x, y}, width, height} starts at pixel (x, y)
+   * @param anchor_point The anchor_point point of the drawn region
+   *           The region will be justified at this point according to the current justification.
+   * @param scale_factor (optional) The scaling factor of the drawn region.
+   *            If specified, the width and height of the region are each scaled by scale_factor.
+   */
+  void draw_surface_region(surface *p_surface, rectangle region, point2d anchor_point, double scale_factor = 1);
+
+  /**
+   * Copy surfaces side by side into one new surface, so they can be kept and drawn from as a single atlas
+   *
+   * @param surfaces The surfaces to copy; they are not freed
+   * @param regions Filled with the region of the atlas each surface was copied to, for draw_surface_region
+   *
+   * @return a pointer to the created surface. This should later be freed using free_surface()
+   */
+  static surface *pack_surfaces(std::vector<surface *> const &surfaces, std::vector<rectangle> &regions);
+
   /**
    * load a png image into a bitmap surface
    *
@@ -510,6 +587,17 @@ protected:
    */
   void update_renderer(cairo_t *cairo, cairo_surface_t *m_surface);
 
+  /**
+   * Restrict drawing to a region of the surface, e.g. the part of a canvas being redrawn.
+   *
+   * Draw calls that fall entirely outside the region are skipped in the same way as off-screen ones.
+   *
+   * @param region The region in pixels.
+   * @param padding Pixels around the region in which draw calls are still made, so that line widths and images
+   *                anchored just outside it are not cut off at its edge.
+   */
+  void set_clip_region(rectangle region, double padding = 0);
+
 private:
   void draw_rectangle_path(point2d start, point2d end, bool fill_flag);
 
@@ -523,6 +611,15 @@ private:
   // Pre-clipping function
   bool rectangle_off_screen(rectangle rect);
 
+  // Converts points to cairo's coordinates in one pass; the result stays valid until the next call
+  point2d const *transform_points(point2d const *points, size_t count);
+
+  // Adds a polyline to the current cairo path, returning false if it is skipped as off screen
+  bool append_polyline_path(point2d const *points, size_t count);
+
+  // Strokes the current path, with round joins when the line cap is round
+  void stroke_polyline_path();
+
   // Current coordinate system (World is the default)
   t_coordinate_system current_coordinate_system = WORLD;
 
@@ -548,6 +645,13 @@ private:
   //A non-owning pointer to camera object
   camera *m_camera;
 
+  // The world area of the clip region, used instead of the visible world for pre-clipping once one is set
+  bool has_clip_region = false;
+  rectangle clip_world;
+
+  // Scratch buffer for transform_points, kept so its capacity is reused between draw calls
+  std::vector<point2d> m_transformed_points;
+
   // Drawing attributes declared and given reasonable defaults below.
 
   // the rotation angle variable used in rotating text
@@ -570,6 +674,15 @@ private:
 
   // Current color
   color current_color = {0, 0, 0, 255};
+
+  // Current font, tracked so unchanged fonts are not selected again and text can be looked up in the text cache.
+  // The font is unknown until it has been set through this renderer, and again after the cairo context changes.
+  std::string current_font_family;
+  font_slant current_font_slant = font_slant::normal;
+  font_weight current_font_weight = font_weight::normal;
+  double current_font_size = 0;
+  bool font_face_known = false;
+  bool font_size_known = false;
 };
 }
 
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ezgl/graphics.hpp"
+#include "frameStats.h"
+
+bool show_frame_stats = false;
+
+// layer times of one frame, which layers it drew, plus the total and when it started
+struct FrameRecord {
+   std::array<double, NUM_FRAME_LAYERS> layer_ms;
+   std::array<bool, NUM_FRAME_LAYERS> layer_drawn;
+   double total_ms;
+   double start_ms;
+};
+
+// ring of the last FRAME_STATS_WINDOW finished frames of one kind
+struct FrameWindow {
+   std::vector<FrameRecord> frames;
+   int next = 0;
+};
+
+// frames that redrew at least one map layer, and frames that only redrew the overlays
+static FrameWindow map_frames;
+static FrameWindow overlay_frames;
+// the frame being drawn
+static FrameRecord current_frame;
+static bool frame_in_progress = false;
+
+// HUD layout in pixels
+const double HUD_MARGIN = 10;
+const double HUD_LINE_HEIGHT = 16;
+const double HUD_WIDTH = 290;
+const double HUD_BAR_WIDTH = 120;
+const double HUD_FONT_SIZE = 11;
+
+// milliseconds on a steady clock, as a double so sub-millisecond frames are not rounded to zero
+static double nowMs(){
+   return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void beginFrame(){
+   if(frame_in_progress){
+      return;
+   }
+   current_frame.layer_ms.fill(0);
+   current_frame.layer_drawn.fill(false);
+   current_frame.start_ms = nowMs();
+   frame_in_progress = true;
+}
+
+void endFrame(){
+   frame_in_progress = false;
+   current_frame.total_ms = nowMs() - current_frame.start_ms;
+   bool map_drawn = false;
+   for(int layer = 0; layer < NUM_FRAME_LAYERS; layer++){
+      map_drawn = map_drawn || (layer != OVERLAYS_LAYER && current_frame.layer_drawn[layer]);
+   }
+   FrameWindow& window = map_drawn ? map_frames : overlay_frames;
+   if((int)window.frames.size() < FRAME_STATS_WINDOW){
+      window.frames.push_back(current_frame);
+   } else {
+      window.frames[window.next] = current_frame;
+   }
+   window.next = (window.next + 1) % FRAME_STATS_WINDOW;
+}
+
+LayerTimer::LayerTimer(FrameLayer timed_layer) : layer(timed_layer), start_ms(nowMs()) {}
+
+LayerTimer::~LayerTimer(){
+   current_frame.layer_ms[layer] += nowMs() - start_ms;
+   current_frame.layer_drawn[layer] = true;
+}
+
+// p50, p95 and max of a set of times (all zero when there are none)
+static FrameTimeSummary summarize(std::vector<double> times){
+   if(times.empty()){
+      return {0, 0, 0};
+   }
+   std::sort(times.begin(), times.end());
+   auto percentile = [&](double p){
+      return times[std::min<int>(times.size() - 1, p * times.size())];
+   };
+   return {percentile(0.5), percentile(0.95), times.back()};
+}
+
+FrameTimeSummary layerTimeSummary(FrameLayer layer){
+   // the overlays are drawn in both kinds of frame
+   std::vector<double> times;
+   for(const FrameWindow* window : {&map_frames, &overlay_frames}){
+      for(const FrameRecord& frame : window->frames){
+         if(frame.layer_drawn[layer]){
+            times.push_back(frame.layer_ms[layer]);
+         }
+      }
+   }
+   return summarize(times);
+}
+
+// percentiles of the total time of the frames in a window
+static FrameTimeSummary totalTimeSummary(const FrameWindow& window){
+   std::vector<double> times;
+   for(const FrameRecord& frame : window.frames){
+      times.push_back(frame.total_ms);
+   }
+   return summarize(times);
+}
+
+FrameTimeSummary frameTimeSummary(){
+   return totalTimeSummary(map_frames);
+}
+
+FrameTimeSummary overlayFrameTimeSummary(){
+   return totalTimeSummary(overlay_frames);
+}
+
+double framesPerSecond(){
+   int count = map_frames.frames.size();
+   if(count < 2){
+      return 0;
+   }
+   // walk the ring from the oldest frame so consecutive records are consecutive frames
+   int oldest = (count < FRAME_STATS_WINDOW) ? 0 : map_frames.next;
+   std::vector<double> intervals;
+   for(int i = 1; i < count; i++){
+      const FrameRecord& previous = map_frames.frames[(oldest + i - 1) % count];
+      const FrameRecord& frame = map_frames.frames[(oldest + i) % count];
+      intervals.push_back(frame.start_ms - previous.start_ms);
+   }
+   double median_interval = summarize(intervals).p50;
+   return median_interval > 0 ? 1000.0 / median_interval : 0;
+}
+
+std::vector<int> frameTimeHistogram(){
+   std::vector<int> buckets(NUM_FRAME_HISTOGRAM_BUCKETS, 0);
+   for(const FrameRecord& frame : map_frames.frames){
+      int bucket = 0;
+      while(bucket < NUM_FRAME_HISTOGRAM_BUCKETS - 1 && frame.total_ms > FRAME_HISTOGRAM_BOUNDS[bucket]){
+         bucket++;
+      }
+      buckets[bucket]++;
+   }
+   return buckets;
+}
+
+std::string frameLayerName(FrameLayer layer){
+   switch(layer){
+      case FEATURES_LAYER: return "features";
+      case ROADS_LAYER: return "roads";
+      case OVERLAYS_LAYER: return "overlays";
+      case NAMES_LAYER: return "names";
+      case POIS_LAYER: return "POIs";
+      default: return "?";
+   }
+}
+
+// one HUD row: a label followed by p50 / p95 / max
+static std::string summaryLine(const std::string& label, const FrameTimeSummary& summary){
+   char line[128];
+   std::snprintf(line, sizeof(line), "%-9s %7.2f %7.2f %7.2f", label.c_str(), summary.p50, summary.p95, summary.max);
+   return line;
+}
+
+void drawFrameStatsHud(ezgl::renderer *g){
+   std::vector<std::string> lines;
+   char header[128];
+   std::snprintf(header, sizeof(header), "%.1f fps, last %d frames (ms)", framesPerSecond(), (int)map_frames.frames.size());
+   lines.push_back(header);
+   char columns[128];
+   std::snprintf(columns, sizeof(columns), "%-9s %7s %7s %7s", "layer", "p50", "p95", "max");
+   lines.push_back(columns);
+   for(int layer = 0; layer < NUM_FRAME_LAYERS; layer++){
+      lines.push_back(summaryLine(frameLayerName((FrameLayer)layer), layerTimeSummary((FrameLayer)layer)));
+   }
+   lines.push_back(summaryLine("frame", frameTimeSummary()));
+   lines.push_back(summaryLine("ovl only", overlayFrameTimeSummary()));
+   std::vector<int> histogram = frameTimeHistogram();
+
+   // screen coordinates so the HUD stays put while the map pans and zooms
+   g->set_coordinate_system(ezgl::SCREEN);
+   double height = HUD_LINE_HEIGHT * (lines.size() + histogram.size() + 1);
+   g->set_color(0, 0, 0, 170);
+   g->fill_rectangle({HUD_MARGIN, HUD_MARGIN}, HUD_WIDTH, height);
+
+   g->set_font_size(HUD_FONT_SIZE);
+   g->format_font("monospace", ezgl::font_slant::normal, ezgl::font_weight::normal);
+   g->set_horiz_justification(ezgl::justification::left);
+   g->set_color(255, 255, 255);
+   double y = HUD_MARGIN + HUD_LINE_HEIGHT;
+   for(const std::string& line : lines){
+      g->draw_text({HUD_MARGIN * 2, y}, line);
+      y += HUD_LINE_HEIGHT;
+   }
+
+   // histogram of frame times, one bar per bucket scaled to the window size
+   int window = std::max<int>(map_frames.frames.size(), 1);
+   for(int bucket = 0; bucket < (int)histogram.size(); bucket++){
+      char label[32];
+      if(bucket < NUM_FRAME_HISTOGRAM_BUCKETS - 1){
+         std::snprintf(label, sizeof(label), "<%5.1f", FRAME_HISTOGRAM_BOUNDS[bucket]);
+      } else {
+         std::snprintf(label, sizeof(label), ">%5.1f", FRAME_HISTOGRAM_BOUNDS[bucket - 1]);
+      }
+      g->set_color(255, 255, 255);
+      g->draw_text({HUD_MARGIN * 2, y}, label);
+      g->set_color(255, 196, 0);
+      g->fill_rectangle({HUD_MARGIN * 2 + 60, y - HUD_LINE_HEIGHT / 2}, HUD_BAR_WIDTH * histogram[bucket] / window, HUD_LINE_HEIGHT - 4);
+      y += HUD_LINE_HEIGHT;
+   }
+   g->set_horiz_justification(ezgl::justification::center);
+   g->set_coordinate_system(ezgl::WORLD);
+}
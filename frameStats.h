@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ezgl/graphics.hpp"
+
+// Frame-time statistics for the map canvas. Each layer drawn is timed with a LayerTimer between the first
+// beginFrame of a canvas update (every layer's draw function calls it, as only some layers may be redrawn)
+// and endFrame in drawOverlays, which runs last; the last FRAME_STATS_WINDOW frames are kept for rolling
+// percentiles, which the HUD shows in the corner of the canvas while show_frame_stats is on. A layer's
+// percentiles only cover the frames that drew it, and frames that only redrew the overlays (highlight
+// changes) are kept apart so their near-zero times do not pull down the map frame statistics.
+
+// layers of the map, in the order they are drawn (the overlays go over the cached layers)
+enum FrameLayer {
+   FEATURES_LAYER,
+   ROADS_LAYER,
+   NAMES_LAYER,
+   POIS_LAYER,
+   OVERLAYS_LAYER,
+   NUM_FRAME_LAYERS
+};
+
+// number of recent frames the statistics cover
+const int FRAME_STATS_WINDOW = 120;
+// upper bounds (ms) of the frame time histogram buckets; the last bucket holds everything slower
+const double FRAME_HISTOGRAM_BOUNDS[] = {4, 8, 16.7, 33.3, 66.7};
+const int NUM_FRAME_HISTOGRAM_BUCKETS = sizeof(FRAME_HISTOGRAM_BOUNDS) / sizeof(FRAME_HISTOGRAM_BOUNDS[0]) + 1;
+
+// whether drawOverlays draws the HUD (toggled with the 'f' key)
+extern bool show_frame_stats;
+
+// rolling statistics of one layer (or the whole frame) in milliseconds
+struct FrameTimeSummary {
+   double p50;
+   double p95;
+   double max;
+};
+
+// marks the start of a frame; does nothing if a frame was begun and not yet ended
+void beginFrame();
+// stores the finished frame's layer times in the rolling window
+void endFrame();
+
+// adds the time until it goes out of scope to a layer of the current frame
+class LayerTimer {
+public:
+   explicit LayerTimer(FrameLayer layer);
+   ~LayerTimer();
+   LayerTimer(const LayerTimer&) = delete;
+   LayerTimer& operator=(const LayerTimer&) = delete;
+
+private:
+   FrameLayer layer;
+   double start_ms;
+};
+
+// percentiles of a layer's time over the frames in the window that drew it
+FrameTimeSummary layerTimeSummary(FrameLayer layer);
+// percentiles of the whole frame time over the map frames in the window
+FrameTimeSummary frameTimeSummary();
+// percentiles of the frame time over the overlay-only frames in their own window
+FrameTimeSummary overlayFrameTimeSummary();
+// map frames drawn per second, from the median time between the starts of recent frames (0 before two frames)
+double framesPerSecond();
+// how many of the map frames in the window fall into each FRAME_HISTOGRAM_BOUNDS bucket
+std::vector<int> frameTimeHistogram();
+// name of a layer as shown in the HUD
+std::string frameLayerName(FrameLayer layer);
+
+// draws the statistics and histogram in screen coordinates in the top left corner of the canvas
+void drawFrameStatsHud(ezgl::renderer *g);
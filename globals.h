@@ -69,7 +69,6 @@ struct StreetSegment_Data{
    IntersectionIdx to_id;  
    bool one_way = false;
    double travel_time;  
-   bool highlight_path = false;
    // street name all lower case no space
    std::string street_name_LCNS;
    double segment_length;
@@ -79,6 +78,8 @@ struct StreetSegment_Data{
    ezgl::point2d from_xy;
    ezgl::point2d to_xy;
    std::vector<ezgl::point2d> curve_points;
+   // bounding box in xy of the end and curve points, computed once at load
+   ezgl::rectangle bounds;
    // checks what type of way it is
    bool highway_motorway = false;
    bool highway_trunk = false;
@@ -106,6 +107,9 @@ struct Feature_Data{
    TypedOSMID feature_OSMID;
    std::vector<ezgl::point2d> feature_point_xy;
    bool is_closed_polygon = false;
+   // area in square meters (0 unless closed) and bounding box in xy, computed once at load
+   double area = 0;
+   ezgl::rectangle bounds;
 
    ~Feature_Data(){
       feature_point_xy.clear();
@@ -118,6 +122,8 @@ struct POIData{
    std::string POI_name;
    ezgl::point2d POI_xy;
    OSMID POI_NodeID;
+   // IconId of the icon drawn for the POI, -1 (NO_ICON) if it has none
+   int icon_id = -1;
 };
 
 struct SubwayLine { 
@@ -135,12 +141,6 @@ struct SubwayLine {
 
 }; 
 
-struct FeatureArea {
-   FeatureIdx id;
-   double area;
-};
-
-
 /*************************************************************************/
 /***************************Global Vectors********************************/
 /*************************************************************************/
@@ -152,8 +152,15 @@ extern std::unordered_map<IntersectionIdx, Intersection_data> intersection_map;
 extern std::vector<StreetSegment_Data> street_segments;
 // stores the data for all the features on the map
 extern std::vector<Feature_Data> features;
+// the closed features with more than one point, largest area first so small features are painted on top
+extern std::vector<FeatureIdx> feature_draw_order;
+// the street segments grouped by draw class, motorways first; the classes are drawn last to first
+const int NUM_STREET_DRAW_CLASSES = 10;
+extern std::vector<std::vector<StreetSegmentIdx>> street_draw_classes;
 // stores the data for all POIs on the map 
 extern std::vector<POIData> POIs;
+// the POIs that have an icon, grouped by icon
+extern std::vector<POIIdx> icon_POIs;
 // Stores all the subway line infos
 extern std::vector<SubwayLine> subway_lines_info; 
 // stores all the coordinates of the streets
@@ -174,6 +181,12 @@ extern std::vector<double> segment_speedLimits;
 extern std::unordered_map< OSMID, const OSMNode*> OSMid_Nodes;
 // Stores all the way data with its OSMID
 extern std::unordered_map<OSMID, const OSMWay*> OSMid_Ways;
+// street segments reachable from the isochrone source
+extern std::vector<StreetSegmentIdx> isochrone_segments;
+// the intersections with highlight set, so the overlay does not have to look through all of them
+extern std::vector<IntersectionIdx> highlighted_intersections;
+// street segments of the path found by the last search, drawn over the streets
+extern std::vector<StreetSegmentIdx> highlighted_path;
 
 
 /*************************************************************************/
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ezgl/graphics.hpp"
+#include "StreetsDatabaseAPI.h"
+#include "globals.h"
+#include "iconAtlas.h"
+#include "tracing.h"
+
+// image of each icon, by IconId
+const char* const ICON_FILES[NUM_ICONS] = {
+   "libstreetmap/resources/hospital_1.png",
+   "libstreetmap/resources/pharmacy_1.png",
+   "libstreetmap/resources/bus_stop_1.png"
+};
+
+// all the icons side by side, and where each one is in it
+static ezgl::surface* atlas = nullptr;
+static std::vector<ezgl::rectangle> icon_regions;
+// the widest or tallest icon in pixels, used to tell when an icon can no longer reach the screen
+static double max_icon_size = 0;
+
+IconId iconForPOIType(const std::string& poi_type){
+   if(poi_type == "hospital"){
+      return HOSPITAL_ICON;
+   } else if(poi_type == "pharmacy"){
+      return PHARMACY_ICON;
+   } else if(poi_type == "bus_station"){
+      return BUS_STATION_ICON;
+   }
+   return NO_ICON;
+}
+
+void loadIconAtlas(){
+   if(atlas != nullptr){
+      return;
+   }
+
+   TRACE_SCOPE("loadIconAtlas");
+
+   std::vector<ezgl::surface*> icons;
+   for(const char* file : ICON_FILES){
+      icons.push_back(ezgl::renderer::load_png(file));
+   }
+   atlas = ezgl::renderer::pack_surfaces(icons, icon_regions);
+   for(ezgl::surface* icon : icons){
+      ezgl::renderer::free_surface(icon);
+   }
+
+   max_icon_size = 0;
+   for(const ezgl::rectangle& region : icon_regions){
+      max_icon_size = std::max({max_icon_size, region.width(), region.height()});
+   }
+}
+
+void freeIconAtlas(){
+   if(atlas != nullptr){
+      ezgl::renderer::free_surface(atlas);
+      atlas = nullptr;
+   }
+   icon_regions.clear();
+}
+
+void drawPOIIconBatch(ezgl::renderer *g, const std::vector<POIIdx>& poi_ids){
+
+   TRACE_SCOPE("drawPOIIconBatch");
+
+   loadIconAtlas();
+
+   // icons are centred on their POI, so one that is at most max_icon_size pixels from the screen may still show
+   ezgl::rectangle visible_world = g->get_visible_world();
+   ezgl::rectangle visible_screen = g->get_visible_screen();
+   double margin = max_icon_size * visible_world.width() / std::max(visible_screen.width(), 1.0);
+   double left = visible_world.left() - margin;
+   double right = visible_world.right() + margin;
+   double bottom = visible_world.bottom() - margin;
+   double top = visible_world.top() + margin;
+
+   for(POIIdx poi_id : poi_ids){
+      const ezgl::point2d& position = POIs[poi_id].POI_xy;
+      if(position.x < left || position.x > right || position.y < bottom || position.y > top){
+         continue;
+      }
+      g->draw_surface_region(atlas, icon_regions[POIs[poi_id].icon_id], position);
+   }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ezgl/graphics.hpp"
+#include "StreetsDatabaseAPI.h"
+
+// POI icons. Every icon PNG is loaded once per application into one atlas surface; POIs are given an icon id
+// from their type when the map loads, and drawing only looks at the POIs that have an icon.
+
+// the icons a POI can be drawn with
+enum IconId {
+   NO_ICON = -1,
+   HOSPITAL_ICON,
+   PHARMACY_ICON,
+   BUS_STATION_ICON,
+   NUM_ICONS
+};
+
+// the icon drawn for a POI type, NO_ICON for types without one
+IconId iconForPOIType(const std::string& poi_type);
+// loads the icon PNGs into the atlas; does nothing once the atlas exists
+void loadIconAtlas();
+// frees the atlas
+void freeIconAtlas();
+// draws the icon of each POI (all of which must have one), skipping those entirely off screen
+void drawPOIIconBatch(ezgl::renderer *g, const std::vector<POIIdx>& poi_ids);
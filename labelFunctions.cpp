@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "ezgl/graphics.hpp"
+#include "StreetsDatabaseAPI.h"
+#include "globals.h"
+#include "drawFunctions.h"
+#include "labelFunctions.h"
+#include "tracing.h"
+
+// cells per side of the grid that finds the candidates inside a tile
+const int LABEL_INDEX_CELLS = 256;
+
+// candidates sorted by importance: road class first, then the longest pieces of road
+static std::vector<LabelCandidate> candidates;
+// every distinct street name once; candidates refer to them by index
+static std::vector<std::string> label_names;
+
+// candidates bucketed into a LABEL_INDEX_CELLS x LABEL_INDEX_CELLS world grid, compressed like the routing graph:
+// the candidates of cell c are cell_candidates[cell_first[c] .. cell_first[c + 1]), in importance order
+static std::vector<int> cell_first;
+static std::vector<int> cell_candidates;
+static ezgl::rectangle index_bounds;
+static double index_cell_width = 1;
+static double index_cell_height = 1;
+
+// a placed label's box in the pixel space of its zoom level
+struct LabelBox {
+   double left;
+   double bottom;
+   double right;
+   double top;
+};
+
+// the labels placed in a tile (those whose centre is inside it) and their boxes, which may reach into the neighbours
+struct LabelTile {
+   std::vector<int> labels;
+   std::vector<LabelBox> boxes;
+};
+
+// placed tiles of each (zoom level, tile x, tile y)
+static std::map<std::tuple<int, int, int>, LabelTile> placed_tiles;
+
+// 0 for motorways, increasing for less important roads
+static int roadPriority(const StreetSegment_Data& segment){
+   if(segment.highway_motorway || segment.highway_motorway_link) return 0;
+   if(segment.highway_trunk || segment.highway_trunk_link) return 1;
+   if(segment.highway_primary || segment.highway_primary_link) return 2;
+   if(segment.highway_secondary) return 3;
+   if(segment.highway_tertiary) return 4;
+   if(segment.highway_residential) return 5;
+   return 6;
+}
+
+// column or row of the candidate index that holds a coordinate
+static int indexCell(double coordinate, double origin, double cell_size){
+   int cell = (coordinate - origin) / cell_size;
+   return std::min(std::max(cell, 0), LABEL_INDEX_CELLS - 1);
+}
+
+void loadLabelCandidates(){
+
+   TRACE_SCOPE("loadLabelCandidates");
+
+   std::unordered_map<std::string, int> name_ids;
+   std::vector<ezgl::point2d> points;
+   for(const StreetSegment_Data& segment : street_segments){
+      if(segment.street_name == "<unknown>"){
+         continue;
+      }
+      auto name = name_ids.emplace(segment.street_name, label_names.size());
+      if(name.second){
+         label_names.push_back(segment.street_name);
+      }
+
+      // the label goes on the longest straight piece of the segment
+      points.clear();
+      points.push_back(segment.from_xy);
+      points.insert(points.end(), segment.curve_points.begin(), segment.curve_points.end());
+      points.push_back(segment.to_xy);
+      int longest = 0;
+      double longest_length = -1;
+      for(int piece = 0; piece + 1 < (int)points.size(); piece++){
+         double length = std::hypot(points[piece + 1].x - points[piece].x, points[piece + 1].y - points[piece].y);
+         if(length > longest_length){
+            longest = piece;
+            longest_length = length;
+         }
+      }
+      ezgl::point2d from = points[longest];
+      ezgl::point2d to = points[longest + 1];
+      // takes care of undefined tan values at 90/-90 degrees
+      double angle = (to.x == from.x) ? DEGREES_90 : std::atan((to.y - from.y) / (to.x - from.x)) * DEGREES_180 / PI;
+      candidates.push_back({name.first->second, {(from.x + to.x) / 2, (from.y + to.y) / 2}, angle, longest_length, roadPriority(segment)});
+   }
+
+   std::stable_sort(candidates.begin(), candidates.end(), [](const LabelCandidate& c1, const LabelCandidate& c2){
+      if(c1.priority != c2.priority){
+         return c1.priority < c2.priority;
+      }
+      return c1.length > c2.length;
+   });
+
+   // bucket the candidates by position; filling the buckets in sorted order keeps each bucket sorted
+   double x_min = std::numeric_limits<double>::infinity(), x_max = -x_min;
+   double y_min = x_min, y_max = -x_min;
+   for(const LabelCandidate& candidate : candidates){
+      x_min = std::min(x_min, candidate.position.x);
+      x_max = std::max(x_max, candidate.position.x);
+      y_min = std::min(y_min, candidate.position.y);
+      y_max = std::max(y_max, candidate.position.y);
+   }
+   if(candidates.empty()){
+      x_min = x_max = y_min = y_max = 0;
+   }
+   index_bounds = ezgl::rectangle({x_min, y_min}, {x_max, y_max});
+   index_cell_width = std::max((x_max - x_min) / LABEL_INDEX_CELLS, 1e-9);
+   index_cell_height = std::max((y_max - y_min) / LABEL_INDEX_CELLS, 1e-9);
+
+   std::vector<int> cell_of(candidates.size());
+   cell_first.assign(LABEL_INDEX_CELLS * LABEL_INDEX_CELLS + 1, 0);
+   for(int id = 0; id < (int)candidates.size(); id++){
+      int column = indexCell(candidates[id].position.x, x_min, index_cell_width);
+      int row = indexCell(candidates[id].position.y, y_min, index_cell_height);
+      cell_of[id] = row * LABEL_INDEX_CELLS + column;
+      cell_first[cell_of[id] + 1]++;
+   }
+   for(int cell = 0; cell < LABEL_INDEX_CELLS * LABEL_INDEX_CELLS; cell++){
+      cell_first[cell + 1] += cell_first[cell];
+   }
+   cell_candidates.resize(candidates.size());
+   std::vector<int> next = cell_first;
+   for(int id = 0; id < (int)candidates.size(); id++){
+      cell_candidates[next[cell_of[id]]++] = id;
+   }
+}
+
+void clearLabels(){
+   candidates.clear();
+   candidates.shrink_to_fit();
+   label_names.clear();
+   label_names.shrink_to_fit();
+   cell_first.clear();
+   cell_first.shrink_to_fit();
+   cell_candidates.clear();
+   cell_candidates.shrink_to_fit();
+   placed_tiles.clear();
+}
+
+// the placement phase of a tile: tiles are placed in a fixed order by phase, so that every pair of tiles that
+// touch (diagonally too) has one tile placed before the other; tiles of the same phase are a whole tile apart
+static int tilePhase(int tile_x, int tile_y){
+   return (tile_x & 1) + 2 * (tile_y & 1);
+}
+
+static const LabelTile& labelTile(int zoom, int tile_x, int tile_y, double scale);
+
+// greedily places the labels of one tile at a zoom level's scale (pixels per xy unit)
+// a label belongs to the tile its centre is in but may cross the tile's edges, so it is checked against the labels
+// of the neighbouring tiles of lower phase, which are placed first; the neighbours of higher phase check against it
+static LabelTile placeTile(int zoom, int tile_x, int tile_y, double scale){
+
+   TRACE_SCOPE("placeLabelTile");
+
+   LabelBox tile = {tile_x * LABEL_TILE_SIZE, tile_y * LABEL_TILE_SIZE, (tile_x + 1) * LABEL_TILE_SIZE, (tile_y + 1) * LABEL_TILE_SIZE};
+   // labels reach at most half a tile past their tile's edges, so this area holds every box they can touch
+   LabelBox area = {tile.left - LABEL_TILE_SIZE / 2, tile.bottom - LABEL_TILE_SIZE / 2, tile.right + LABEL_TILE_SIZE / 2, tile.top + LABEL_TILE_SIZE / 2};
+
+   // gather the candidates inside the tile from the index; sorting the ids puts them in importance order
+   std::vector<int> inside;
+   int first_column = indexCell(tile.left / scale, index_bounds.left(), index_cell_width);
+   int last_column = indexCell(tile.right / scale, index_bounds.left(), index_cell_width);
+   int first_row = indexCell(tile.bottom / scale, index_bounds.bottom(), index_cell_height);
+   int last_row = indexCell(tile.top / scale, index_bounds.bottom(), index_cell_height);
+   for(int row = first_row; row <= last_row; row++){
+      for(int column = first_column; column <= last_column; column++){
+         int cell = row * LABEL_INDEX_CELLS + column;
+         inside.insert(inside.end(), cell_candidates.begin() + cell_first[cell], cell_candidates.begin() + cell_first[cell + 1]);
+      }
+   }
+   std::sort(inside.begin(), inside.end());
+
+   const int grid_side = std::ceil((area.right - area.left) / LABEL_GRID_CELL);
+   std::vector<std::vector<int>> grid(grid_side * grid_side);
+   std::vector<LabelBox> boxes;
+   std::unordered_map<int, std::vector<ezgl::point2d>> shown_names;
+   LabelTile placed;
+
+   // adds a box to the grid cells it covers
+   auto addToGrid = [&](const LabelBox& box){
+      int first_cell_x = std::max(0, (int)((box.left - area.left) / LABEL_GRID_CELL));
+      int last_cell_x = std::min(grid_side - 1, (int)((box.right - area.left) / LABEL_GRID_CELL));
+      int first_cell_y = std::max(0, (int)((box.bottom - area.bottom) / LABEL_GRID_CELL));
+      int last_cell_y = std::min(grid_side - 1, (int)((box.top - area.bottom) / LABEL_GRID_CELL));
+      for(int cell_y = first_cell_y; cell_y <= last_cell_y; cell_y++){
+         for(int cell_x = first_cell_x; cell_x <= last_cell_x; cell_x++){
+            grid[cell_y * grid_side + cell_x].push_back(boxes.size());
+         }
+      }
+      boxes.push_back(box);
+   };
+
+   // the labels the neighbours of lower phase already show, both as obstacles and for the repeated name check
+   for(int dy = -1; dy <= 1; dy++){
+      for(int dx = -1; dx <= 1; dx++){
+         if(tilePhase(tile_x + dx, tile_y + dy) >= tilePhase(tile_x, tile_y)){
+            continue;
+         }
+         const LabelTile& neighbour = labelTile(zoom, tile_x + dx, tile_y + dy, scale);
+         for(int label = 0; label < (int)neighbour.labels.size(); label++){
+            const LabelBox& box = neighbour.boxes[label];
+            shown_names[candidates[neighbour.labels[label]].name_id].push_back({(box.left + box.right) / 2, (box.bottom + box.top) / 2});
+            if(box.left < area.right && area.left < box.right && box.bottom < area.top && area.bottom < box.top){
+               addToGrid(box);
+            }
+         }
+      }
+   }
+
+   for(int id : inside){
+      const LabelCandidate& candidate = candidates[id];
+      ezgl::point2d center = {candidate.position.x * scale, candidate.position.y * scale};
+      if(center.x < tile.left || center.x >= tile.right || center.y < tile.bottom || center.y >= tile.top){
+         continue;
+      }
+      // the name has to fit along its piece of road
+      double width = label_names[candidate.name_id].size() * LABEL_FONT_SIZE * LABEL_CHAR_WIDTH;
+      if(width > candidate.length * scale){
+         continue;
+      }
+
+      // axis-aligned box around the rotated label
+      double radians = candidate.angle * PI / DEGREES_180;
+      double half_width = (width * std::abs(std::cos(radians)) + LABEL_FONT_SIZE * std::abs(std::sin(radians))) / 2 + LABEL_PADDING;
+      double half_height = (width * std::abs(std::sin(radians)) + LABEL_FONT_SIZE * std::abs(std::cos(radians))) / 2 + LABEL_PADDING;
+      // a label wider than half a tile could reach a tile of the same phase, which is placed without knowing about it
+      if(half_width >= LABEL_TILE_SIZE / 2 || half_height >= LABEL_TILE_SIZE / 2){
+         continue;
+      }
+      LabelBox box = {center.x - half_width, center.y - half_height, center.x + half_width, center.y + half_height};
+
+      // one label per name in a neighbourhood
+      std::vector<ezgl::point2d>& shown = shown_names[candidate.name_id];
+      bool repeated = std::any_of(shown.begin(), shown.end(), [&](const ezgl::point2d& other){
+         return std::hypot(other.x - center.x, other.y - center.y) < LABEL_NAME_REPEAT_DISTANCE;
+      });
+      if(repeated){
+         continue;
+      }
+
+      // collision test against the labels already in the grid cells the box covers
+      int first_cell_x = std::max(0, (int)((box.left - area.left) / LABEL_GRID_CELL));
+      int last_cell_x = std::min(grid_side - 1, (int)((box.right - area.left) / LABEL_GRID_CELL));
+      int first_cell_y = std::max(0, (int)((box.bottom - area.bottom) / LABEL_GRID_CELL));
+      int last_cell_y = std::min(grid_side - 1, (int)((box.top - area.bottom) / LABEL_GRID_CELL));
+      bool collides = false;
+      for(int cell_y = first_cell_y; cell_y <= last_cell_y && !collides; cell_y++){
+         for(int cell_x = first_cell_x; cell_x <= last_cell_x && !collides; cell_x++){
+            for(int other : grid[cell_y * grid_side + cell_x]){
+               const LabelBox& other_box = boxes[other];
+               if(box.left < other_box.right && other_box.left < box.right && box.bottom < other_box.top && other_box.bottom < box.top){
+                  collides = true;
+                  break;
+               }
+            }
+         }
+      }
+      if(collides){
+         continue;
+      }
+
+      addToGrid(box);
+      shown.push_back(center);
+      placed.labels.push_back(id);
+      placed.boxes.push_back(box);
+   }
+   return placed;
+}
+
+// the placed labels of a tile, placing it (and the neighbours it depends on) if it is not cached yet
+static const LabelTile& labelTile(int zoom, int tile_x, int tile_y, double scale){
+   auto tile = placed_tiles.find({zoom, tile_x, tile_y});
+   if(tile == placed_tiles.end()){
+      tile = placed_tiles.emplace(std::make_tuple(zoom, tile_x, tile_y), placeTile(zoom, tile_x, tile_y, scale)).first;
+   }
+   return tile->second;
+}
+
+void drawStreetLabels(ezgl::renderer *g){
+
+   TRACE_SCOPE("drawStreetLabels");
+
+   ezgl::rectangle visible_world = g->get_visible_world();
+   ezgl::rectangle visible_screen = g->get_visible_screen();
+   if(candidates.empty() || visible_world.width() <= 0 || visible_screen.width() <= 0){
+      return;
+   }
+
+   // place at the most zoomed out scale of the current level, so labels only spread apart as the view zooms in
+   double pixels_per_unit = visible_screen.width() / visible_world.width();
+   int zoom = std::floor(std::log2(pixels_per_unit) * LABEL_ZOOM_STEPS_PER_OCTAVE);
+   double scale = std::pow(2.0, (double)zoom / LABEL_ZOOM_STEPS_PER_OCTAVE);
+
+   if(placed_tiles.size() > LABEL_CACHE_MAX_TILES){
+      placed_tiles.clear();
+   }
+
+   g->format_font("Noto", ezgl::font_slant::normal, ezgl::font_weight::normal, LABEL_FONT_SIZE);
+   // sets street name colour to white on night mode
+   g->set_color(night_mode ? ezgl::WHITE : ezgl::BLACK);
+
+   // labels of the tiles around the drawn area can reach into it
+   ezgl::rectangle draw_world = g->get_clip_world();
+   int first_tile_x = std::floor(draw_world.left() * scale / LABEL_TILE_SIZE) - 1;
+   int last_tile_x = std::floor(draw_world.right() * scale / LABEL_TILE_SIZE) + 1;
+   int first_tile_y = std::floor(draw_world.bottom() * scale / LABEL_TILE_SIZE) - 1;
+   int last_tile_y = std::floor(draw_world.top() * scale / LABEL_TILE_SIZE) + 1;
+   for(int tile_y = first_tile_y; tile_y <= last_tile_y; tile_y++){
+      for(int tile_x = first_tile_x; tile_x <= last_tile_x; tile_x++){
+         for(int id : labelTile(zoom, tile_x, tile_y, scale).labels){
+            const LabelCandidate& candidate = candidates[id];
+            g->set_text_rotation(candidate.angle);
+            g->draw_text(candidate.position, label_names[candidate.name_id]);
+         }
+      }
+   }
+   g->set_text_rotation(0);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ezgl/graphics.hpp"
+#include "StreetsDatabaseAPI.h"
+
+// Street name placement. loadLabelCandidates picks one candidate position per named street segment (the middle
+// of its longest straight piece) and shares one copy of each distinct street name between them. Drawing places
+// labels greedily, most important road first, rejecting any that would not fit on its piece of road, overlap an
+// already placed label on a screen-space grid, or repeat a name close to where it is already shown. Placement is
+// done per zoom level and square tile of the view and cached, so panning and redrawing only place new tiles. Labels
+// may cross tile edges: tiles are placed in a fixed order of four phases, each checking against the labels of its
+// already placed neighbours, so the result does not depend on which tiles were drawn first.
+
+// font size (pixels) of street labels
+const double LABEL_FONT_SIZE = 10;
+// estimated width of a character relative to the font size, used to size labels before they are drawn
+const double LABEL_CHAR_WIDTH = 0.6;
+// empty space (pixels) kept around every label
+const double LABEL_PADDING = 2;
+// side (pixels) of the screen-space collision grid cells
+const double LABEL_GRID_CELL = 32;
+// side (pixels) of a placement tile
+const double LABEL_TILE_SIZE = 512;
+// a name is not repeated within this many pixels of where it is already shown; less than a tile, so only the
+// neighbouring tiles have to be checked
+const double LABEL_NAME_REPEAT_DISTANCE = 300;
+// zoom levels per doubling of scale; placement is shared by all scales within a level
+const int LABEL_ZOOM_STEPS_PER_OCTAVE = 2;
+// the label cache is dropped when it holds more placed tiles than this
+const size_t LABEL_CACHE_MAX_TILES = 4096;
+
+// a place a street name can be drawn
+struct LabelCandidate {
+   // index into the distinct street names
+   int name_id;
+   // middle of the straight piece of road the label sits on (xy), and that piece's direction and length
+   ezgl::point2d position;
+   double angle;
+   double length;
+   // road class, 0 for the most important roads
+   int priority;
+};
+
+// builds the label candidates of all named street segments; call after the street segment data is loaded
+void loadLabelCandidates();
+// drops the candidates and all cached placements
+void clearLabels();
+// places (or takes from the cache) and draws the street labels of the visible tiles
+void drawStreetLabels(ezgl::renderer *g);
@@ -1,7 +1,8 @@
 
-#include <chrono>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <limits>
 
 #include "StreetsDatabaseAPI.h"
 #include "OSMDatabaseAPI.h"
@@ -10,6 +11,8 @@
 #include "globals.h"
 #include "loadFunctions.h"
 #include "math.h"
+#include "tracing.h"
+#include "iconAtlas.h"
 
 
 /********************************************************************************/
@@ -20,8 +23,7 @@
 // Loads data for intersection latitude/longitude and Cartesian values
 void loadIntersectionData(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadIntersectionData");
 
    // Set the min and max LatLon to false values
    initializeMaxMin();
@@ -39,23 +41,16 @@ void loadIntersectionData(){
       // set max min latlon based on new intersection data
       setMaxMin(inter_id);
    }
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadIntersectionData took " << elapasedTime.count() << "seconds." <<std::endl;
-
 }
 
 // Loads the XY positions of the from and to intersections for each street segment
 void loadStreetSegmentData(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadStreetSegmentData");
 
    // resize the street segments vector to accomodate all segments
    street_segments.resize(getNumStreetSegments());
+   street_draw_classes.assign(NUM_STREET_DRAW_CLASSES, std::vector<StreetSegmentIdx>());
    
    // create an iterator to access the streets in the map
    std::unordered_map<int, Street>::iterator street;
@@ -69,20 +64,40 @@ void loadStreetSegmentData(){
       loadCurvePoints(ss_id);
       // loads all highway tags to the struct
       loadHighwayOSMTags(ss_id, street_seg); 
+      // the class decides when the segment is drawn, so the classes are built here once rather than every frame
+      street_draw_classes[streetDrawClass(street_segments[ss_id])].push_back(ss_id);
    }
+}
 
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadStreetSegmentData took " << elapasedTime.count() << "seconds." <<std::endl;
+// Returns the draw class of a segment, 0 for motorways down to NUM_STREET_DRAW_CLASSES - 1 for other ways
+int streetDrawClass(const StreetSegment_Data& segment){
+   if (segment.highway_motorway) {
+      return 0;
+   } else if (segment.highway_trunk) {
+      return 1;
+   } else if (segment.highway_primary) {
+      return 2;
+   } else if (segment.highway_secondary) {
+      return 3;
+   } else if (segment.highway_tertiary) {
+      return 4;
+   } else if (segment.highway_residential) {
+      return 5;
+   } else if (segment.highway_road) {
+      return 6;
+   } else if (segment.highway_pedestrian) {
+      return 7;
+   } else if (segment.highway_livingstreet) {
+      return 8;
+   }
+   // falls into "other" category
+   return NUM_STREET_DRAW_CLASSES - 1;
 }
 
 // Loads the latitude/longitude positions of all the map features
 void loadFeatureData() {
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadFeatureData");
 
    int num_features = getNumFeatures();
    // reserve space in vector to avoid excessive memory allocation
@@ -97,13 +112,20 @@ void loadFeatureData() {
       int num_feat_points = getNumFeaturePoints(feat_id);
       // reserve space in vector to avoid excessive memory allocation
       feature.feature_point_xy.reserve(num_feat_points);
+      double x_min = std::numeric_limits<double>::infinity(), x_max = -x_min;
+      double y_min = x_min, y_max = -x_min;
       for(int point_idx = 0; point_idx < num_feat_points; point_idx++) {
          // first must convert from latlon
          LatLon point_pos = getFeaturePoint(feat_id, point_idx);
-         feature.feature_point_xy.emplace_back(
-            x_from_lon(point_pos.longitude()),
-            y_from_lat(point_pos.latitude())
-         );
+         ezgl::point2d point_xy(x_from_lon(point_pos.longitude()), y_from_lat(point_pos.latitude()));
+         feature.feature_point_xy.push_back(point_xy);
+         x_min = std::min(x_min, point_xy.x);
+         x_max = std::max(x_max, point_xy.x);
+         y_min = std::min(y_min, point_xy.y);
+         y_max = std::max(y_max, point_xy.y);
+      }
+      if(num_feat_points > 0) {
+         feature.bounds = ezgl::rectangle({x_min, y_min}, {x_max, y_max});
       }
       // determine if feature is a line or a closed polygon
       LatLon first_point_pos = getFeaturePoint(feat_id, 0);
@@ -111,22 +133,24 @@ void loadFeatureData() {
       if(first_point_pos == last_point_pos) {
          feature.is_closed_polygon = true;
       }
+      // only closed features are filled, so only they need an area and a place in the draw order
+      if(feature.is_closed_polygon && num_feat_points > 1) {
+         feature.area = findFeatureArea(feat_id);
+         feature_draw_order.push_back(feat_id);
+      }
       features.push_back(feature);
    }
 
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadFeatureData took " << elapasedTime.count() << "seconds." <<std::endl;
-
+   // paint the largest features first so smaller ones (e.g. an island in a lake) end up on top
+   std::stable_sort(feature_draw_order.begin(), feature_draw_order.end(), [](FeatureIdx f1, FeatureIdx f2) {
+      return features[f1].area > features[f2].area;
+   });
 }
 
 // Loads the names and attributes of points of interest (POIs)
 void loadPOIData(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadPOIData");
 
    int num_POIs = getNumPointsOfInterest();
    POIs.resize(num_POIs);
@@ -142,21 +166,22 @@ void loadPOIData(){
       double POI_lat = POI_pos.latitude();
       POIs[POI_id].POI_xy.x = x_from_lon(POI_lon);
       POIs[POI_id].POI_xy.y = y_from_lat(POI_lat); 
+      // intern the type to the icon drawn for it
+      POIs[POI_id].icon_id = iconForPOIType(POIs[POI_id].POI_type);
+      if(POIs[POI_id].icon_id != NO_ICON){
+         icon_POIs.push_back(POI_id);
+      }
    }
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadPOIData took " << elapasedTime.count() << "seconds." <<std::endl;
-
+   // group the icon POIs by icon so drawing reads one icon's pixels at a time
+   std::stable_sort(icon_POIs.begin(), icon_POIs.end(), [](POIIdx p1, POIIdx p2) {
+      return POIs[p1].icon_id < POIs[p2].icon_id;
+   });
 }
 
 // Loads all the street point2ds into its respective data structure
 void loadStreetPoints(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadStreetPoints");
 
    std::vector<ezgl::point2d>::iterator pointxy;
    for (StreetSegment_Data& segment : street_segments){
@@ -173,20 +198,12 @@ void loadStreetPoints(){
       }
       street_points[segment.street_id].push_back(segment.to_xy);
    }
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadStreetPoints took " << elapasedTime.count() << "seconds." <<std::endl;
-
 }
 
 // loads all the subway related information
 void loadSubwayOSMValues(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadSubwayOSMValues");
 
    // initialize the vector
    std::vector<TypedOSMID> subway_stations;
@@ -234,13 +251,6 @@ void loadSubwayOSMValues(){
          }
       }
    }
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadSubwayOSMValues took " << elapasedTime.count() << "seconds." <<std::endl;
-
 }
 
 /*************************************************************************/
@@ -351,6 +361,18 @@ void loadCurvePoints(int& ss_id){
       street_segments[ss_id].curve_points[cp_id].x = x_from_lon(curve_point_lon);
       street_segments[ss_id].curve_points[cp_id].y = y_from_lat(curve_point_lat);
    }
+
+   // the bounding box of the whole polyline, so the segment can be culled without looking at its points
+   const StreetSegment_Data& segment = street_segments[ss_id];
+   double x_min = std::min(segment.from_xy.x, segment.to_xy.x), x_max = std::max(segment.from_xy.x, segment.to_xy.x);
+   double y_min = std::min(segment.from_xy.y, segment.to_xy.y), y_max = std::max(segment.from_xy.y, segment.to_xy.y);
+   for(const ezgl::point2d& point : segment.curve_points){
+      x_min = std::min(x_min, point.x);
+      x_max = std::max(x_max, point.x);
+      y_min = std::min(y_min, point.y);
+      y_max = std::max(y_max, point.y);
+   }
+   street_segments[ss_id].bounds = ezgl::rectangle({x_min, y_min}, {x_max, y_max});
 }
 
 void loadHighwayOSMTags(int& ss_id, StreetSegmentInfo& street_seg){
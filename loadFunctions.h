@@ -30,3 +30,5 @@ void loadStreetSegmentDataHelper(int& ss_id, StreetSegmentInfo& street_seg, std:
 void loadCurvePoints(int& ss_id);
 // loads the osm highway tags into the struct 
 void loadHighwayOSMTags(int& ss_id, StreetSegmentInfo& street_seg);
+// returns the draw class of a segment from its highway tags, most important first
+int streetDrawClass(const StreetSegment_Data& segment);
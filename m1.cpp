@@ -30,6 +30,10 @@
 #include <algorithm>
 #include <iterator>
 #include "globals.h"
+#include "routingGraph.h"
+#include "speedProfiles.h"
+#include "crpOverlay.h"
+#include "altLandmarks.h"
 
 
 /**************************Global Variables********************************/
@@ -110,6 +114,8 @@ bool loadMap(std::string map_path) {
     loadOSMNodesByIdNumber();
     // stores the average latitude for the city 
     AvgLat();
+    // builds the read-only adjacency arrays the path searches walk
+    loadRoutingGraph();
 
     return true;
 
@@ -131,6 +137,10 @@ void closeMap() {
     streets.clear();
     OSMid_Nodes.clear();
     OSMid_Ways.clear();
+    clearCrpOverlay();
+    clearLandmarks();
+    clearRoutingGraph();
+    clearSpeedProfiles();
     clearDatabases();
     std::cout << "Map closed" << std::endl;
 }
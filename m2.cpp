@@ -20,7 +20,6 @@
  * SOFTWARE.
  */
 
-#include <chrono>
 #include <cmath>
 #include <string>
 #include <sstream>
@@ -46,16 +45,27 @@
 #include "globals.h"
 #include "loadFunctions.h"
 #include "drawFunctions.h"
+#include "labelFunctions.h"
 #include "math.h"
+#include "tracing.h"
+#include "frameStats.h"
+#include "iconAtlas.h"
 #include "searchFunctions.h"
+#include "routingFunctions.h"
 
 
 /********************************************************************************/
 /******************************Function Declaration******************************/
 /********************************************************************************/
 
-// draws the ezgl mapper canvas and calls the draw functions
+// draws the base layer of the canvas: the background and the features
 void drawMainCanvas(ezgl::renderer *g);
+// draw the cached layers over the features, each redrawn on its own when only what it shows changes
+void drawRoadsLayer(ezgl::renderer *g);
+void drawLabelsLayer(ezgl::renderer *g);
+void drawPOIsLayer(ezgl::renderer *g);
+// draws what changes without the map changing (highlights, path, isochrone, HUD) over the cached map
+void drawOverlays(ezgl::renderer *g);
 // holds the callback functions for all the gtk buttons
 void initial_setup(ezgl::application *app, bool /*new_window*/);
 // highlights intersections when clicked
@@ -71,8 +81,6 @@ void toggle_night_mode(GtkSwitch* , gboolean night_mode_on, ezgl::application* a
 // A callback function that toggles the subway stations and routes on the map
 void drawSubwayLinesCallback(GtkSwitch* /*self*/, gboolean showSubwayLines, ezgl::application* app);
 
-// measures the frames per seconds (FPS) of the gis
-void FPS();
 //changes the map when a new map is selected on the drop down menu
 void changeMap(GtkWidget* widget, gpointer data);
 //turns POIs on or off when the switch is flipped
@@ -83,6 +91,10 @@ void help(GtkButton* /*self*/, ezgl::application* app);
 void clear(GtkButton* /*self*/, ezgl::application* app);
 // Clears all the search entries
 void clearSearchEntry(ezgl::application* app);
+// highlights every street that can be driven from the last clicked intersection within ISOCHRONE_TIME_LIMIT
+void showIsochrone(ezgl::application* app);
+// starts a tracing session, or ends the current one and saves it to TRACE_OUTPUT_PATH
+void toggleTracing(ezgl::application* app);
 
 
 
@@ -96,8 +108,14 @@ std::vector<Intersection_data> intersections;
 std::vector<StreetSegment_Data> street_segments;
 // A vector that stores the data for all the features on the map
 std::vector<Feature_Data> features;
+// The closed features in the order they are painted, largest area first
+std::vector<FeatureIdx> feature_draw_order;
+// The street segments in their draw classes, most important class first
+std::vector<std::vector<StreetSegmentIdx>> street_draw_classes;
 // A vector that stores the data for all POIs on the map 
 std::vector<POIData> POIs;
+// The POIs that are drawn with an icon
+std::vector<POIIdx> icon_POIs;
 // A vector that stores the name and colour of all the subway stations 
 std::vector<const OSMNode*> osmSubwayStations;
 // Stores all the subway lines and its associated information
@@ -111,6 +129,23 @@ double max_lon;
 double min_lon;
 int numOfRightClicks = 0;
 IntersectionIdx from_intersection, to_intersection;
+// the intersection most recently left clicked, -1 before the first click
+IntersectionIdx last_clicked_intersection = -1;
+// street segments reachable from the isochrone source, drawn over the streets
+std::vector<StreetSegmentIdx> isochrone_segments;
+// intersections highlighted by clicks and searches
+std::vector<IntersectionIdx> highlighted_intersections;
+// segments of the last path found
+std::vector<StreetSegmentIdx> highlighted_path;
+// driving time (seconds) and turn penalty used for the isochrone shown with the 'i' key
+const double ISOCHRONE_TIME_LIMIT = 600;
+const double ISOCHRONE_TURN_PENALTY = 15;
+// where the 't' key saves a tracing session, in Chrome's trace event format
+const std::string TRACE_OUTPUT_PATH = "trace.json";
+// names of the canvas layers drawn over the base layer, bottom to top
+const std::string ROADS_CANVAS_LAYER = "roads";
+const std::string LABELS_CANVAS_LAYER = "labels";
+const std::string POIS_CANVAS_LAYER = "POIs";
 
 // Holds all the intersection and its data
 std::unordered_map<IntersectionIdx, Intersection_data> intersection_map;
@@ -152,21 +187,29 @@ void drawMap() {
       {x_from_lon(min_lon), y_from_lat(min_lat)}, 
       {x_from_lon(max_lon), y_from_lat(max_lat)}};
    // parameters are: location, co-ordinate system, and callback function
-   application.add_canvas("MainCanvas", drawMainCanvas, initial_world);
+   ezgl::canvas* canvas = application.add_canvas("MainCanvas", drawMainCanvas, initial_world);
+   // each layer is cached, so a switch only redraws the layers it affects
+   canvas->add_layer(ROADS_CANVAS_LAYER, drawRoadsLayer);
+   canvas->add_layer(LABELS_CANVAS_LAYER, drawLabelsLayer);
+   canvas->add_layer(POIS_CANVAS_LAYER, drawPOIsLayer);
+   // highlights and paths are redrawn over a cached copy of the map instead of redrawing the whole map
+   canvas->set_overlay_callback(drawOverlays);
    // passes control to EZGL and opens graphics window 
    application.run(initial_setup, act_on_mouse_click, nullptr, act_on_key_press);
+   // the icons are kept for the whole run, across map changes
+   freeIconAtlas();
 
 }
 
 void loadHelperFunctions(){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("loadHelperFunctions");
 
    loadIntersectionData();
    std::cout << "--intersection data loaded---" << std::endl;
    loadStreetSegmentData();
    std::cout << "--street segment data loaded---" << std::endl;
+   loadLabelCandidates();
    loadFeatureData();
    std::cout << "--feature data loaded---" << std::endl;
    loadPOIData();
@@ -175,41 +218,14 @@ void loadHelperFunctions(){
    loadStreetPoints();
 
    std::cout << "--Subway data loaded---" << std::endl;
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "loadHelperFunctions took " << elapasedTime.count() << "seconds." <<std::endl;
-}
-
-// Finds the fps of the rendering
-void FPS() {
-   // Define a static variable to keep track of the last time the function was called
-   static std::chrono::time_point<std::chrono::steady_clock> last_time;
-   // Get the current time
-   auto current_time = std::chrono::steady_clock::now();
-   // Calculate the time difference between the current time and the last time the function was called
-   auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_time).count();
-   // Calculate the FPS based on the time difference
-   double fps = MILLISECONDS_PER_SECOND / time_diff;
-   // Update the last time to the current time
-   last_time = current_time;
-
-   // Print the FPS to the console
-   std::cout << "FPS: " << fps << std::endl;
 }
 
-// called by application.run() to draw the canvas
-// calls all the helper functions to draw map features
+// called by application.run() to draw the base layer of the canvas
+// draws the background and the map features under the other layers
 void drawMainCanvas(ezgl::renderer *g){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
-
-   //Define zoom levels 
-   int level;
-   zoom_levels(g, level);
+   TRACE_SCOPE("drawMainCanvas");
+   beginFrame();
 
    // set background color to grey
    g->set_color(background_color);
@@ -223,24 +239,70 @@ void drawMainCanvas(ezgl::renderer *g){
       g->fill_rectangle(g->get_visible_world());
    }
    // Draw features
-   drawFeatures(g);
-   // Draw street segments
+   {
+      LayerTimer timer(FEATURES_LAYER);
+      drawFeatures(g);
+   }
+}
+
+// Draw street segments
+void drawRoadsLayer(ezgl::renderer *g){
+
+   TRACE_SCOPE("drawRoadsLayer");
+   beginFrame();
+
+   //Define zoom levels 
+   int level;
+   zoom_levels(g, level);
+
+   LayerTimer timer(ROADS_LAYER);
    drawStreetSegments(g, level);
-   // Draw intersections when searched for
-   drawIntersections(g);
-   // Draw street names
-   drawStreetNames(g);
+}
+
+// Draw street names
+void drawLabelsLayer(ezgl::renderer *g){
+
+   TRACE_SCOPE("drawLabelsLayer");
+   beginFrame();
+
+   LayerTimer timer(NAMES_LAYER);
+   drawStreetLabels(g);
+}
+
+// Draw the POI icons when they are switched on
+void drawPOIsLayer(ezgl::renderer *g){
+
+   TRACE_SCOPE("drawPOIsLayer");
+   beginFrame();
 
    if(show_POI){
+      LayerTimer timer(POIS_LAYER);
       drawPOIIcons(g);
    }
+}
 
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "drawMainCanvas took " << elapasedTime.count() << "seconds." <<std::endl;
+// called by the canvas over the layers whenever any of them is redrawn, and on its own when only highlights change
+// draws over a cached copy of the map, possibly clipped to the area that changed
+void drawOverlays(ezgl::renderer *g){
+
+   TRACE_SCOPE("drawOverlays");
+   // a frame of its own when no layer was redrawn
+   beginFrame();
+   {
+      LayerTimer timer(OVERLAYS_LAYER);
+      // Draw the area reachable from the isochrone source
+      drawIsochrone(g);
+      // Draw the path found by the last search
+      drawHighlightedPath(g);
+      // Draw intersections when searched for
+      drawIntersections(g);
+   }
+   endFrame();
 
+   // the HUD is drawn after the frame is measured so it does not count itself
+   if(show_frame_stats){
+      drawFrameStatsHud(g);
+   }
 }
 
 
@@ -278,6 +340,11 @@ void initial_setup(ezgl::application *app, bool /*new_window*/){
 
    GObject *clear_btn = app->get_object("clear");
    g_signal_connect(clear_btn, "clicked", G_CALLBACK(clear), app);
+
+   // tracing turned on from the environment has been recording since the map started loading
+   if(tracingEnabled()){
+      app->update_message("Tracing since startup, press 't' to save the trace.");
+   }
    
    //callback for the map changing combo box (Drop down menu)
    GObject *mapSelect = app->get_object("comboBxMp");
@@ -292,29 +359,29 @@ void initial_setup(ezgl::application *app, bool /*new_window*/){
 // Highlights the intersection on mouse click and displays information in the terminal
 void act_on_mouse_click(ezgl::application* app, GdkEventButton* event, double x, double y){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("act_on_mouse_click");
 
    // set variable for LatLon of where mouse is clicked 
    LatLon pos = LatLon(lat_from_y(y), lon_from_x(x));
    if (event->button == 1){ // left click check
       // determine closest intersection from the clicked LatLon value 
       IntersectionIdx selected_intersection = findClosestIntersection(pos);
+      last_clicked_intersection = selected_intersection;
       // set the highlight state to retain filled in intersection with map refreshes
       if(intersection_map[selected_intersection].highlight != true){
-         intersection_map[selected_intersection].highlight = true;
+         highlightIntersection(selected_intersection, true);
          std::string message = "Intersection Selected: " + getIntersectionName(selected_intersection) + "  " + std::to_string(selected_intersection);
          std::cout << event << std::endl;
          // output message to status bar at bottom of graphics window 
          app->update_message(message);
       } else{
-         intersection_map[selected_intersection].highlight = false;
+         highlightIntersection(selected_intersection, false);
          std::string message = "Unselected intersection: " + getIntersectionName(selected_intersection) + "  " + std::to_string(selected_intersection);
          app->update_message(message);
       }
 
-      // refreshed the map image with changed state for highlight 
-      app->refresh_drawing();
+      // redraw only the area of the changed highlight (padded by a pixel for rounding)
+      app->invalidate_drawing(intersectionHighlightBounds(selected_intersection), 1);
    }
    else if (event->button == 3){ // right click check
       clearSearchEntry(app);
@@ -325,40 +392,76 @@ void act_on_mouse_click(ezgl::application* app, GdkEventButton* event, double x,
       if (numOfRightClicks == 1){
          // set the selected intersection as from intersection
          from_intersection = findClosestIntersection(pos);
-         intersection_map[from_intersection].highlight = true;
+         highlightIntersection(from_intersection, true);
          message = "Selected 'from' Intersection: " + getIntersectionName(from_intersection) + "  " + std::to_string(from_intersection);
          app->update_message(message);
+         app->invalidate_drawing(intersectionHighlightBounds(from_intersection), 1);
          // check if the user right clicked another location, if true, then set that selected intersection
          // as the to intersection
       } else if (numOfRightClicks == 2){
          to_intersection = findClosestIntersection(pos);
-         intersection_map[to_intersection].highlight = true;
+         highlightIntersection(to_intersection, true);
          message = "Selected 'to' Intersection: " + getIntersectionName(to_intersection) + "  " + std::to_string(to_intersection);
          app->update_message(message);
-      } 
-      app->refresh_drawing();
-      // if number of clicks are two
-      if(numOfRightClicks == 2){
+         // the search zooms to the path, which redraws the map
          searchUponClick(from_intersection, to_intersection, app);
-      } else if (numOfRightClicks > 2){
+      } else {
          message = "Cannot select more than two intersections.";
          app->update_message(message);
          numOfRightClicks =  0;
          clearHighlights();
+         app->refresh_overlay();
       }
    }
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "act_on_mouse_click took " << elapasedTime.count() << "seconds." <<std::endl;
 }
 
 // Checks if the user presses any keys 
 void act_on_key_press(ezgl::application* application, GdkEventKey* /*event*/, char *key_name){
    searchDropdownList(application);
    std::cout<< "Key Pressed: " << key_name << std::endl;
+
+   // key presses reach this callback even while a search bar is being typed in
+   GtkWidget* focus = gtk_window_get_focus(GTK_WINDOW(application->get_object("MainWindow")));
+   if(std::string(key_name) == "i" && !GTK_IS_ENTRY(focus)){
+      showIsochrone(application);
+   }
+   if(std::string(key_name) == "t" && !GTK_IS_ENTRY(focus)){
+      toggleTracing(application);
+   }
+   if(std::string(key_name) == "f" && !GTK_IS_ENTRY(focus)){
+      show_frame_stats = !show_frame_stats;
+      application->refresh_overlay();
+   }
+}
+
+// Shows what a driver can reach from the last clicked intersection
+void showIsochrone(ezgl::application* app){
+   if(last_clicked_intersection < 0){
+      app->update_message("Click an intersection first to see what can be reached from it.");
+      return;
+   }
+   Isochrone isochrone = findIsochrone(last_clicked_intersection, ISOCHRONE_TIME_LIMIT, ISOCHRONE_TURN_PENALTY);
+   isochrone_segments = std::move(isochrone.segments);
+
+   std::string message = std::to_string(isochrone.reached.size()) + " intersections reachable within "
+      + std::to_string((int)(ISOCHRONE_TIME_LIMIT / 60)) + " minutes of " + getIntersectionName(last_clicked_intersection);
+   app->update_message(message);
+   app->refresh_overlay();
+}
+
+// Records how long loading and drawing take until 't' is pressed again
+void toggleTracing(ezgl::application* app){
+   if(!tracingEnabled()){
+      setTracingEnabled(true);
+      app->update_message("Tracing started, press 't' again to save the trace.");
+      return;
+   }
+   setTracingEnabled(false);
+   if(dumpTrace(TRACE_OUTPUT_PATH)){
+      app->update_message("Trace saved to " + TRACE_OUTPUT_PATH + ", open it in chrome://tracing.");
+   } else {
+      app->update_message("Could not write " + TRACE_OUTPUT_PATH + ".");
+   }
 }
 
 void toggle_night_mode(GtkSwitch* /*self*/, gboolean night_mode_on, ezgl::application* app){
@@ -366,7 +469,9 @@ void toggle_night_mode(GtkSwitch* /*self*/, gboolean night_mode_on, ezgl::applic
       night_mode = true;
    else  
       night_mode = false;
-   app->refresh_drawing();
+   // only the background, features and street names change color
+   app->refresh_layer(BASE_LAYER);
+   app->refresh_layer(LABELS_CANVAS_LAYER);
 }
 
 void clearDatabases(){
@@ -374,7 +479,10 @@ void clearDatabases(){
    intersections.clear();
    street_segments.clear();
    features.clear();
+   feature_draw_order.clear();
+   street_draw_classes.clear();
    POIs.clear();
+   icon_POIs.clear();
    subway_lines_info.clear();
    osmSubwayStations.clear();
    street_points.clear();
@@ -383,11 +491,19 @@ void clearDatabases(){
    OSMid_Ways.clear();
    maps.clear();
    intersection_map.clear();
+   isochrone_segments.clear();
+   highlighted_intersections.clear();
+   highlighted_path.clear();
+   last_clicked_intersection = -1;
+   clearLabels();
 
    intersections.shrink_to_fit();
    street_segments.shrink_to_fit();
    features.shrink_to_fit();
+   feature_draw_order.shrink_to_fit();
+   street_draw_classes.shrink_to_fit();
    POIs.shrink_to_fit();
+   icon_POIs.shrink_to_fit();
    subway_lines_info.shrink_to_fit();
    osmSubwayStations.shrink_to_fit();
    segment_speedLimits.shrink_to_fit();
@@ -397,8 +513,7 @@ void clearDatabases(){
 //changes the map when the user selects a new map from drop down menu 
 void changeMap(GtkWidget* widget, gpointer data){
 
-   // stores the time when the function began
-   auto startTime = std::chrono::high_resolution_clock::now();
+   TRACE_SCOPE("changeMap");
 
    // Cast the data pointer to a renderer object
    ezgl::application* app = static_cast<ezgl::application*>(data);
@@ -439,14 +554,6 @@ void changeMap(GtkWidget* widget, gpointer data){
       {"Tokyo", "tokyo_japan"},
       {"Toronto", "toronto_canada"},
    };
-
-
-   // calculates the elapsed time for the function to run
-   auto endTime = std::chrono::high_resolution_clock::now();
-   auto elapasedTime = 
-      std::chrono::duration_cast<std::chrono::duration<double>>(endTime - startTime);
-   std::cout << "changeMap took " << elapasedTime.count() << "seconds." <<std::endl;
-
 }
 
 //The callback function when the POI switch is toggled
@@ -456,14 +563,14 @@ void toggle_POIs(GtkSwitch* /*self*/, gboolean show_poi, ezgl::application* app)
    } else {
       show_POI = false;
    }
-   app->refresh_drawing();
+   app->refresh_layer(POIS_CANVAS_LAYER);
 }
 
 //Creates a new window with instructions when the help button is called
 void help(GtkButton* /*self*/, ezgl::application* app){
    GObject *helpWindow = app->get_object("HelpWindow");
    GtkDialogFlags flags = GTK_DIALOG_DESTROY_WITH_PARENT;
-   GtkWidget* help_message = gtk_message_dialog_new (GTK_WINDOW(helpWindow), flags, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "This map is designed with your safety in mind. \n\nFor directions from intersection A to intersection B, please enter one street name of intersection A in the top left text box and the second in the top right box. \nFor example, if intersection A is Bloor Street and Yonge Street, type Bloor Street into the top left and Yonge Street into the text box next to it. Do the same for intersection B using the text boxes below and press 'Find Directions'. \nAlternatively, you can press on the desired intersections (marked with purple boxes) to find the quickest path between them.\n\nIf you prefer a darker colour scheme, toggle our 'Night Mode' Switch to change the colours. \nIf you prefer a cleaner map without the various location names and symbols, toggle the 'POI's' switch. \nIn order to change to a map of a different city, open the dropdown box that is initialized as 'Select Map' and change the map to the city of your choice.");
+   GtkWidget* help_message = gtk_message_dialog_new (GTK_WINDOW(helpWindow), flags, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "This map is designed with your safety in mind. \n\nFor directions from intersection A to intersection B, please enter one street name of intersection A in the top left text box and the second in the top right box. \nFor example, if intersection A is Bloor Street and Yonge Street, type Bloor Street into the top left and Yonge Street into the text box next to it. Do the same for intersection B using the text boxes below and press 'Find Directions'. \nAlternatively, you can press on the desired intersections (marked with purple boxes) to find the quickest path between them.\n\nIf you prefer a darker colour scheme, toggle our 'Night Mode' Switch to change the colours. \nIf you prefer a cleaner map without the various location names and symbols, toggle the 'POI's' switch. \nIn order to change to a map of a different city, open the dropdown box that is initialized as 'Select Map' and change the map to the city of your choice.\n\nTo see where you can drive in 10 minutes, click an intersection and press 'i'.\nTo profile the map, press 't' to start a trace and 't' again to save it, or 'f' to show frame times.");
    gtk_dialog_run (GTK_DIALOG (help_message));
    gtk_widget_destroy (help_message);
 }
@@ -473,7 +580,8 @@ void clear(GtkButton* /*self*/, ezgl::application* app){
    numOfRightClicks = 0;
    clearSearchEntry(app);
    clearHighlights();
-   app->refresh_drawing();
+   isochrone_segments.clear();
+   app->refresh_overlay();
 }
 
 // Function clears the search entries
@@ -20,42 +20,16 @@
  */
 
 #include <vector>
+#include <chrono>
+#include <random>
 #include "StreetsDatabaseAPI.h"
-#include "FindSimplePath.h"
+#include "m1.h"
+#include "m3.h"
+#include "m4.h"
+#include "courierFunctions.h"
 
-
-//Specifies a delivery order (input to your algorithm).
-//To satisfy the order the item-to-be-delivered must have been picked-up 
-//from the pickUp intersection before visiting the dropOff intersection.
-struct DeliveryInf {
-
-    // Constructor
-    DeliveryInf(IntersectionIdx pick_up, IntersectionIdx drop_off)
-        : pickUp(pick_up), dropOff(drop_off) {}
-
-    //The intersection id where the item-to-be-delivered is picked-up.
-    IntersectionIdx pickUp;
-
-    //The intersection id where the item-to-be-delivered is dropped-off.
-    IntersectionIdx dropOff;
-};
-
-
-// Specifies one subpath of the courier truck route
-struct CourierSubPath {
-
-    // The intersection id where a start depot, pick-up intersection or 
-    // drop-off intersection is located
-    IntersectionIdx start_intersection;
-
-    // The intersection id where this subpath ends. This must be the 
-    // start_intersection of the next subpath or the intersection of an end depot
-    IntersectionIdx end_intersection;
-
-    // Street segment ids of the path between start_intersection and end_intersection 
-    // They form a connected path (see m3.h)
-    std::vector<StreetSegmentIdx> subpath;
-};
+// fixed seed so the same deliveries always produce the same route
+const unsigned COURIER_RANDOM_SEED = 297;
 
 
 // This routine takes in a vector of D deliveries (pickUp, dropOff
@@ -104,27 +78,44 @@ struct CourierSubPath {
 std::vector<CourierSubPath> travelingCourier(
                             const std::vector<DeliveryInf>& deliveries,
                             const std::vector<IntersectionIdx>& depots,
-                            const float turn_penalty);
+                            const float turn_penalty){
 
-/**
- * @brief A simple pathfinding function with no turn penalty
- * This function will not compile or run until after Milestone 3 
- * is over.
- *
- * If you do not have a working findPathBetweenIntersections from
- * milestone 3, this file includes a Djikstra algorithm with no turn 
- * penalties that you can use for milestone 4.
- *
- * The function prototype is:
- * std::vector<StreetSegmentIdx> findSimplePath(
- *           const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids);
- *
- * The function is calling 2 of your own milestone 1 functions:
- *	- findStreetSegmentsOfIntersection
- *	- findStreetSegmentTravelTime
- * so those functions must be implemented and correct.
- *
- * @note If you have a working solution from milestone 3, it is better to use 
- *       it instead of findSimplePath, as it will give smaller travel times 
- *       due to handling turn penalties, and it may also have lower cpu time.
- */
\ No newline at end of file
+    auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(COURIER_ANNEAL_DEADLINE));
+
+    // every leg the annealer can evaluate is looked up in this matrix
+    CourierMatrix matrix = buildCourierMatrix(deliveries, depots, turn_penalty);
+    CourierMoveEngine engine(matrix, greedyCourierTour(matrix));
+    // a tour that still pays the penalty means some stop cannot be reached from the others
+    if (engine.cost() >= UNREACHABLE_PENALTY){
+        return {};
+    }
+
+    std::mt19937 rng(COURIER_RANDOM_SEED);
+    annealCourierTour(engine, deadline, rng);
+    if (engine.cost() >= UNREACHABLE_PENALTY){
+        return {};
+    }
+
+    // expand the stop order into depot -> stops -> depot street segment subpaths
+    const std::vector<int>& tour = engine.tour();
+    std::vector<IntersectionIdx> route;
+    route.reserve(tour.size() + 2);
+    route.push_back(matrix.best_start_depot[tour.front()]);
+    for (int stop : tour){
+        route.push_back(matrix.stops[stop].intersection);
+    }
+    route.push_back(matrix.best_end_depot[tour.back()]);
+
+    std::vector<CourierSubPath> subpaths;
+    subpaths.reserve(route.size() - 1);
+    for (int leg = 0; leg + 1 < (int)route.size(); leg++){
+        CourierSubPath subpath;
+        subpath.start_intersection = route[leg];
+        subpath.end_intersection = route[leg + 1];
+        subpath.subpath = findPathBetweenIntersections(std::make_pair(route[leg], route[leg + 1]), turn_penalty);
+        subpaths.push_back(subpath);
+    }
+    return subpaths;
+}
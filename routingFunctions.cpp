@@ -0,0 +1,495 @@
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "StreetsDatabaseAPI.h"
+#include "m3.h"
+#include "routingGraph.h"
+#include "routingFunctions.h"
+#include "threadPool.h"
+#include "routingQueues.h"
+#include "speedProfiles.h"
+#include "trafficWeights.h"
+
+#define NO_EDGE -1
+
+// queue used by dijkstra, changed with setRoutingQueueType
+static std::atomic<RoutingQueueType> routing_queue_type(BINARY_HEAP_QUEUE);
+
+void SearchWorkspace::reset(){
+    int num_intersections = routing_graph.numIntersections();
+    if (map_id != routing_graph.map_id || (int)label_stamp.size() != num_intersections){
+        map_id = routing_graph.map_id;
+        label_stamp.assign(num_intersections, 0);
+        settled_stamp.assign(num_intersections, 0);
+        shortest_time.resize(num_intersections);
+        prev_edge.resize(num_intersections);
+        prev_node.resize(num_intersections);
+        origin.resize(num_intersections);
+        generation = 0;
+    }
+    generation++;
+    // after the counter wraps, old stamps could match again, so clear them once
+    if (generation == 0){
+        std::fill(label_stamp.begin(), label_stamp.end(), 0);
+        std::fill(settled_stamp.begin(), settled_stamp.end(), 0);
+        generation = 1;
+    }
+}
+
+SearchWorkspace& threadSearchWorkspace(int slot){
+    // slots nobody uses stay empty, since a workspace only allocates on its first reset
+    thread_local SearchWorkspace workspaces[NUM_WORKSPACE_SLOTS];
+    return workspaces[slot];
+}
+
+// the search behind dijkstra for one kind of queue
+template <class Queue, class Stats>
+static bool dijkstraWithQueue(IntersectionIdx startID, IntersectionIdx destID, std::vector<StreetSegmentIdx>& optimalPath, double turn_penalty, SearchWorkspace& workspace, Queue& toVisit, Stats& stats) {
+    const RoutingGraph& graph = routing_graph;
+    // one snapshot for the whole search, however many traffic updates land meanwhile
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+
+    toVisit.update(startID, 0.0);
+    stats.pushed(toVisit.size());
+    workspace.label(startID, 0.0, NO_EDGE, NO_EDGE);
+
+    // while the queue is not empty
+    while (!toVisit.empty()) {
+        // Get the next node to visit from the front of the queue
+        int curr = toVisit.pop().node;
+        stats.popped();
+
+        // if already visited, skip
+        if (workspace.isSettled(curr)){
+            continue;
+        }
+        workspace.settle(curr);
+        stats.settled();
+
+        // Check if this is the destination node stop search
+        if (curr == destID) {
+            // walk the previous edges back to the start, then flip them into driving order
+            while (workspace.prevEdge(curr) != NO_EDGE) {
+                optimalPath.push_back(workspace.prevEdge(curr));
+                curr = workspace.prevNode(curr);
+            }
+            std::reverse(optimalPath.begin(), optimalPath.end());
+            return true;
+        }
+
+        // the label, not the popped key, since queues without decrease-key can hand out stale entries first
+        double currTime = workspace.time(curr);
+        StreetSegmentIdx prevEdge = workspace.prevEdge(curr);
+        // Loop through all the edges that can be driven out of the current node
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++) {
+            const RoutingEdge& edge = graph.out_edges[e];
+            stats.relaxed();
+
+            // Calculate the total time to reach the next intersection via the current edge
+            double totalTime = currTime + weights->time(edge.segment);
+
+            // Add a turn penalty if the current street is different from the previous street
+            if (prevEdge != NO_EDGE && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]) {
+                totalTime += turn_penalty;
+            }
+
+            // Check if the total time to reach the next intersection is shorter than the current shortest time
+            if (totalTime < workspace.time(edge.to)){
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+                stats.pushed(toVisit.size());
+            }
+        }
+    }
+    // If we reach this point, there is no path from the start node to the destination node
+    return false;
+}
+
+// one queue of each kind per thread, so their memory is reused like the search workspace
+template <class Queue>
+static Queue& threadQueue() {
+    thread_local Queue queue;
+    return queue;
+}
+
+// calls search with this thread's instance of the selected queue type
+template <class Search>
+static auto withSelectedQueue(Search search) {
+    switch (routing_queue_type.load(std::memory_order_relaxed)) {
+        case FOUR_ARY_HEAP_QUEUE:
+            return search(threadQueue<FourAryHeapQueue>());
+        case RADIX_HEAP_QUEUE:
+            return search(threadQueue<RadixHeapQueue>());
+        default:
+            return search(threadQueue<BinaryHeapQueue>());
+    }
+}
+
+bool dijkstra(IntersectionIdx startID, IntersectionIdx destID, std::vector<StreetSegmentIdx>& optimalPath, double turn_penalty, SearchWorkspace& workspace) {
+    NoSearchStats stats;
+    return dijkstra(startID, destID, optimalPath, turn_penalty, workspace, stats);
+}
+
+template <class Stats>
+bool dijkstra(IntersectionIdx startID, IntersectionIdx destID, std::vector<StreetSegmentIdx>& optimalPath, double turn_penalty, SearchWorkspace& workspace, Stats& stats) {
+    return withSelectedQueue([&](auto& toVisit) {
+        return dijkstraWithQueue(startID, destID, optimalPath, turn_penalty, workspace, toVisit, stats);
+    });
+}
+
+template bool dijkstra<NoSearchStats>(IntersectionIdx, IntersectionIdx, std::vector<StreetSegmentIdx>&, double, SearchWorkspace&, NoSearchStats&);
+template bool dijkstra<CountingSearchStats>(IntersectionIdx, IntersectionIdx, std::vector<StreetSegmentIdx>&, double, SearchWorkspace&, CountingSearchStats&);
+
+std::vector<StreetSegmentIdx> findPathWithStats(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, SearchStats& stats) {
+    CountingSearchStats counting;
+    std::vector<StreetSegmentIdx> path;
+    dijkstra(intersect_ids.first, intersect_ids.second, path, turn_penalty, threadSearchWorkspace(), counting);
+    stats = counting.counts;
+    return path;
+}
+
+void setRoutingQueueType(RoutingQueueType type) {
+    routing_queue_type.store(type);
+}
+
+RoutingQueueType getRoutingQueueType() {
+    return routing_queue_type.load();
+}
+
+std::vector<std::vector<StreetSegmentIdx>> findPathsBetweenIntersections(const std::vector<std::pair<IntersectionIdx, IntersectionIdx>>& intersect_ids, const double turn_penalty){
+    std::vector<std::vector<StreetSegmentIdx>> paths(intersect_ids.size());
+    WorkStealingPool& pool = WorkStealingPool::instance();
+
+    // the workers are long-lived, so each one's thread-local workspace is reused across queries and batches
+    pool.parallelFor(intersect_ids.size(), [&](int query, unsigned){
+        std::vector<StreetSegmentIdx> path;
+        if (dijkstra(intersect_ids[query].first, intersect_ids[query].second, path, turn_penalty, threadSearchWorkspace())){
+            paths[query] = std::move(path);
+        }
+    });
+    return paths;
+}
+
+double computePathTravelTime(const std::vector<StreetSegmentIdx>& path, const double turn_penalty, const WeightSnapshot& weights) {
+    const RoutingGraph& graph = routing_graph;
+    double travel_time = 0;
+    for (int i = 0; i < (int)path.size(); i++) {
+        travel_time += weights.time(path[i]);
+        if (i > 0 && graph.segment_street[path[i - 1]] != graph.segment_street[path[i]]) {
+            travel_time += turn_penalty;
+        }
+    }
+    return travel_time;
+}
+
+// the search behind findIsochrone for one kind of queue
+template <class Queue>
+static Isochrone isochroneWithQueue(IntersectionIdx source, double time_limit, double turn_penalty, SearchWorkspace& workspace, Queue& toVisit) {
+    const RoutingGraph& graph = routing_graph;
+    // one snapshot for the whole search, however many traffic updates land meanwhile
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+
+    Isochrone isochrone;
+    toVisit.update(source, 0.0);
+    workspace.label(source, 0.0, NO_EDGE, NO_EDGE);
+    while (!toVisit.empty()) {
+        int curr = toVisit.pop().node;
+        if (workspace.isSettled(curr)) {
+            continue;
+        }
+        workspace.settle(curr);
+        double currTime = workspace.time(curr);
+        isochrone.reached.push_back({curr, currTime});
+
+        StreetSegmentIdx prevEdge = workspace.prevEdge(curr);
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++) {
+            const RoutingEdge& edge = graph.out_edges[e];
+            double totalTime = currTime + weights->time(edge.segment);
+            if (prevEdge != NO_EDGE && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]) {
+                totalTime += turn_penalty;
+            }
+            // nothing past the limit is queued, so the search stops by itself once the limit is reached
+            if (totalTime > time_limit) {
+                continue;
+            }
+            isochrone.segments.push_back(edge.segment);
+            if (totalTime < workspace.time(edge.to)) {
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+            }
+        }
+    }
+
+    // two-way segments can be driven completely from both ends
+    std::sort(isochrone.segments.begin(), isochrone.segments.end());
+    isochrone.segments.erase(std::unique(isochrone.segments.begin(), isochrone.segments.end()), isochrone.segments.end());
+    return isochrone;
+}
+
+Isochrone findIsochrone(IntersectionIdx source, double time_limit, double turn_penalty) {
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    return withSelectedQueue([&](auto& toVisit) {
+        return isochroneWithQueue(source, time_limit, turn_penalty, workspace, toVisit);
+    });
+}
+
+
+/********************************************************************************/
+/******************************Alternative Routes********************************/
+/********************************************************************************/
+
+// Grows a shortest path tree from source, over the reversed graph if reverse is set, settling everything
+// within time_limit. If target is settled first, the limit tightens to (1 + stretch) times its time.
+// Returns the intersections in the order they were settled.
+template <class Queue>
+static std::vector<IntersectionIdx> growSearchTree(IntersectionIdx source, bool reverse, double turn_penalty, double time_limit, IntersectionIdx target, double stretch, const WeightSnapshot& weights, SearchWorkspace& workspace, Queue& toVisit) {
+    const RoutingGraph& graph = routing_graph;
+    const std::vector<int>& first_edge = reverse ? graph.first_in : graph.first_out;
+    const std::vector<RoutingEdge>& edges = reverse ? graph.in_edges : graph.out_edges;
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+
+    std::vector<IntersectionIdx> settled_order;
+    toVisit.update(source, 0.0);
+    workspace.label(source, 0.0, NO_EDGE, NO_EDGE);
+    while (!toVisit.empty()) {
+        int curr = toVisit.pop().node;
+        if (workspace.isSettled(curr)) {
+            continue;
+        }
+        double currTime = workspace.time(curr);
+        if (currTime > time_limit) {
+            break;
+        }
+        workspace.settle(curr);
+        settled_order.push_back(curr);
+        if (curr == target) {
+            time_limit = std::min(time_limit, currTime * (1 + stretch));
+        }
+
+        StreetSegmentIdx prevEdge = workspace.prevEdge(curr);
+        for (int e = first_edge[curr]; e < first_edge[curr + 1]; e++) {
+            const RoutingEdge& edge = edges[e];
+            double totalTime = currTime + weights.time(edge.segment);
+            if (prevEdge != NO_EDGE && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]) {
+                totalTime += turn_penalty;
+            }
+            if (totalTime <= time_limit && totalTime < workspace.time(edge.to)) {
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+            }
+        }
+    }
+    return settled_order;
+}
+
+// the route start -> via along the forward tree, then via -> destination along the backward tree
+static std::vector<StreetSegmentIdx> routeThrough(IntersectionIdx via, const SearchWorkspace& forward, const SearchWorkspace& backward) {
+    std::vector<StreetSegmentIdx> path;
+    for (IntersectionIdx inter = via; forward.prevEdge(inter) != NO_EDGE; inter = forward.prevNode(inter)) {
+        path.push_back(forward.prevEdge(inter));
+    }
+    std::reverse(path.begin(), path.end());
+    // in the backward tree the previous edge of an intersection leads towards the destination
+    for (IntersectionIdx inter = via; backward.prevEdge(inter) != NO_EDGE; inter = backward.prevNode(inter)) {
+        path.push_back(backward.prevEdge(inter));
+    }
+    return path;
+}
+
+// true if the path never passes through the same intersection twice
+static bool isSimplePath(const std::vector<StreetSegmentIdx>& path, IntersectionIdx start) {
+    const RoutingGraph& graph = routing_graph;
+    std::unordered_set<IntersectionIdx> seen = {start};
+    IntersectionIdx curr = start;
+    for (StreetSegmentIdx seg : path) {
+        // find which end of the segment the path continues to
+        IntersectionIdx next = -1;
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++) {
+            if (graph.out_edges[e].segment == seg) {
+                next = graph.out_edges[e].to;
+                break;
+            }
+        }
+        if (next == -1 || !seen.insert(next).second) {
+            return false;
+        }
+        curr = next;
+    }
+    return true;
+}
+
+std::vector<AlternativeRoute> findAlternativeRoutes(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, int max_routes) {
+    IntersectionIdx start = intersect_ids.first;
+    IntersectionIdx destination = intersect_ids.second;
+    SearchWorkspace& forward = threadSearchWorkspace(0);
+    SearchWorkspace& backward = threadSearchWorkspace(1);
+    // both trees have to see the same travel times
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+
+    // until the destination is settled the forward search has no limit; after that it stops at the stretch
+    std::vector<IntersectionIdx> forward_order = withSelectedQueue([&](auto& toVisit) {
+        return growSearchTree(start, false, turn_penalty, std::numeric_limits<double>::infinity(), destination, ALTERNATIVE_MAX_STRETCH, *weights, forward, toVisit);
+    });
+    if (!forward.isSettled(destination) || max_routes <= 0) {
+        return {};
+    }
+    double fastest_time = forward.time(destination);
+    double time_limit = fastest_time * (1 + ALTERNATIVE_MAX_STRETCH);
+    withSelectedQueue([&](auto& toVisit) {
+        return growSearchTree(destination, true, turn_penalty, time_limit, -1, 0.0, *weights, backward, toVisit);
+    });
+
+    // the fastest route is the forward tree's path, exactly what findPathBetweenIntersections returns
+    std::vector<AlternativeRoute> routes;
+    std::vector<StreetSegmentIdx> fastest = routeThrough(destination, forward, backward);
+    routes.push_back({fastest, computePathTravelTime(fastest, turn_penalty, *weights)});
+
+    // A plateau is a chain of edges both trees use in the same direction. Walking the forward settle order,
+    // an intersection continues the plateau of its forward parent if the parent's backward edge is the
+    // edge that led here; otherwise it starts a new one.
+    struct Plateau {
+        IntersectionIdx end;
+        double length;
+    };
+    std::unordered_map<IntersectionIdx, IntersectionIdx> plateau_start;
+    std::unordered_map<IntersectionIdx, Plateau> plateaus;
+    for (IntersectionIdx inter : forward_order) {
+        if (!backward.isSettled(inter) || forward.time(inter) + backward.time(inter) > time_limit) {
+            continue;
+        }
+        IntersectionIdx parent = forward.prevNode(inter);
+        IntersectionIdx first = inter;
+        if (parent != -1 && backward.isSettled(parent) && backward.prevEdge(parent) == forward.prevEdge(inter)) {
+            auto found = plateau_start.find(parent);
+            if (found != plateau_start.end()) {
+                first = found->second;
+            }
+        }
+        plateau_start[inter] = first;
+        plateaus[first] = {inter, forward.time(inter) - forward.time(first)};
+    }
+
+    // the longest plateaus give the most natural detours
+    std::vector<Plateau> candidates;
+    for (const auto& [first, plateau] : plateaus) {
+        candidates.push_back(plateau);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Plateau& a, const Plateau& b) {
+        return a.length > b.length || (a.length == b.length && a.end < b.end);
+    });
+
+    std::vector<std::unordered_set<StreetSegmentIdx>> chosen_segments = {
+        std::unordered_set<StreetSegmentIdx>(fastest.begin(), fastest.end())};
+    for (const Plateau& candidate : candidates) {
+        if ((int)routes.size() >= max_routes) {
+            break;
+        }
+        std::vector<StreetSegmentIdx> path = routeThrough(candidate.end, forward, backward);
+        double travel_time = computePathTravelTime(path, turn_penalty, *weights);
+        if (travel_time > time_limit || !isSimplePath(path, start)) {
+            continue;
+        }
+
+        // reject routes that mostly repeat one already chosen
+        double path_time = 0;
+        std::vector<double> shared_time(chosen_segments.size(), 0);
+        for (StreetSegmentIdx seg : path) {
+            path_time += weights->time(seg);
+            for (int r = 0; r < (int)chosen_segments.size(); r++) {
+                if (chosen_segments[r].count(seg)) {
+                    shared_time[r] += weights->time(seg);
+                }
+            }
+        }
+        bool distinct = true;
+        for (double shared : shared_time) {
+            if (shared > ALTERNATIVE_MAX_SHARED * path_time) {
+                distinct = false;
+            }
+        }
+        if (!distinct) {
+            continue;
+        }
+        chosen_segments.emplace_back(path.begin(), path.end());
+        routes.push_back({std::move(path), travel_time});
+    }
+
+    // the alternatives follow the fastest route in order of travel time
+    std::stable_sort(routes.begin() + 1, routes.end(), [](const AlternativeRoute& a, const AlternativeRoute& b) {
+        return a.travel_time < b.travel_time;
+    });
+    return routes;
+}
+
+
+/********************************************************************************/
+/****************************Time-Dependent Routing******************************/
+/********************************************************************************/
+
+// the search behind findTimeDependentPath for one kind of queue; labels are arrival clock times
+template <class Queue>
+static TimedPath timeDependentWithQueue(IntersectionIdx startID, IntersectionIdx destID, double departure_time, double turn_penalty, SearchWorkspace& workspace, Queue& toVisit) {
+    const RoutingGraph& graph = routing_graph;
+    // one snapshot for the whole search, so every segment keeps one base time and the profiles stay FIFO
+    std::shared_ptr<const WeightSnapshot> weights = currentWeights();
+    workspace.reset();
+    toVisit.prepare(graph.numIntersections());
+    toVisit.clear();
+
+    TimedPath timed = {{}, departure_time, std::numeric_limits<double>::infinity()};
+    toVisit.update(startID, departure_time);
+    workspace.label(startID, departure_time, NO_EDGE, NO_EDGE);
+    while (!toVisit.empty()) {
+        int curr = toVisit.pop().node;
+        if (workspace.isSettled(curr)) {
+            continue;
+        }
+        workspace.settle(curr);
+        double currTime = workspace.time(curr);
+
+        if (curr == destID) {
+            timed.arrival_time = currTime;
+            while (workspace.prevEdge(curr) != NO_EDGE) {
+                timed.path.push_back(workspace.prevEdge(curr));
+                curr = workspace.prevNode(curr);
+            }
+            std::reverse(timed.path.begin(), timed.path.end());
+            return timed;
+        }
+
+        StreetSegmentIdx prevEdge = workspace.prevEdge(curr);
+        for (int e = graph.first_out[curr]; e < graph.first_out[curr + 1]; e++) {
+            const RoutingEdge& edge = graph.out_edges[e];
+            double enterTime = currTime;
+            if (prevEdge != NO_EDGE && graph.segment_street[prevEdge] != graph.segment_street[edge.segment]) {
+                enterTime += turn_penalty;
+            }
+            // the profiles are FIFO, so the earliest arrival here is also the best one to continue from
+            double totalTime = enterTime + timeDependentTravelTime(edge.segment, enterTime, *weights);
+            if (totalTime < workspace.time(edge.to)) {
+                workspace.label(edge.to, totalTime, edge.segment, curr);
+                toVisit.update(edge.to, totalTime);
+            }
+        }
+    }
+    return timed;
+}
+
+TimedPath findTimeDependentPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, double departure_time, const double turn_penalty) {
+    SearchWorkspace& workspace = threadSearchWorkspace();
+    return withSelectedQueue([&](auto& toVisit) {
+        return timeDependentWithQueue(intersect_ids.first, intersect_ids.second, departure_time, turn_penalty, workspace, toVisit);
+    });
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include "StreetsDatabaseAPI.h"
+#include "trafficWeights.h"
+
+// Per-intersection search labels that survive between searches. Every label carries the generation of the
+// search that wrote it, so starting a new search just bumps the generation: labels from older searches
+// read as unreached without touching the arrays. They are only reallocated when a different map is loaded.
+class SearchWorkspace {
+public:
+    // prepares for a new search on the loaded routing graph
+    void reset();
+
+    // best known time to an intersection, infinity if the current search has not reached it
+    double time(IntersectionIdx inter) const {
+        return label_stamp[inter] == generation ? shortest_time[inter] : std::numeric_limits<double>::infinity();
+    }
+    bool isSettled(IntersectionIdx inter) const { return settled_stamp[inter] == generation; }
+    void settle(IntersectionIdx inter) { settled_stamp[inter] = generation; }
+
+    // segment and intersection the current best label came through, -1 for a search source
+    StreetSegmentIdx prevEdge(IntersectionIdx inter) const { return label_stamp[inter] == generation ? prev_edge[inter] : -1; }
+    IntersectionIdx prevNode(IntersectionIdx inter) const { return label_stamp[inter] == generation ? prev_node[inter] : -1; }
+    // the source a multi-source search reached this intersection from
+    IntersectionIdx source(IntersectionIdx inter) const { return label_stamp[inter] == generation ? origin[inter] : -1; }
+
+    void label(IntersectionIdx inter, double time, StreetSegmentIdx via_edge, IntersectionIdx via_node, IntersectionIdx from_source = -1) {
+        label_stamp[inter] = generation;
+        shortest_time[inter] = time;
+        prev_edge[inter] = via_edge;
+        prev_node[inter] = via_node;
+        origin[inter] = from_source;
+    }
+
+private:
+    unsigned generation = 0;
+    unsigned map_id = 0;
+    std::vector<unsigned> label_stamp;
+    std::vector<unsigned> settled_stamp;
+    std::vector<double> shortest_time;
+    std::vector<StreetSegmentIdx> prev_edge;
+    std::vector<IntersectionIdx> prev_node;
+    std::vector<IntersectionIdx> origin;
+};
+
+// searches that keep two trees at once (forward and backward) use a second slot
+const int NUM_WORKSPACE_SLOTS = 2;
+// the calling thread's workspace, so repeated searches on one thread (or pool worker) share their memory
+SearchWorkspace& threadSearchWorkspace(int slot = 0);
+
+// priority queues dijkstra can run on (see routingQueues.h)
+// the binary heap is the default; the radix heap rounds times to RadixHeapQueue::DEFAULT_QUANTUM seconds
+enum RoutingQueueType {
+    BINARY_HEAP_QUEUE,
+    FOUR_ARY_HEAP_QUEUE,
+    RADIX_HEAP_QUEUE,
+    NUM_ROUTING_QUEUE_TYPES
+};
+
+// selects the queue used by every later dijkstra call, on all threads
+void setRoutingQueueType(RoutingQueueType type);
+RoutingQueueType getRoutingQueueType();
+
+// what one search did, for finding out why a query was slow
+struct SearchStats {
+    long settled = 0;
+    // edges (or overlay arcs) looked at from settled intersections
+    long relaxations = 0;
+    // queue updates, inserts and decrease-keys alike
+    long pushes = 0;
+    long pops = 0;
+    // most entries in the queue at once, stale ones included
+    long peak_queue_size = 0;
+};
+
+// Statistics policies for the search templates. Every hook of NoSearchStats is empty and inlines away, so
+// the plain queries compile to the same code as before; CountingSearchStats fills in a SearchStats.
+struct NoSearchStats {
+    void popped() {}
+    void settled() {}
+    void relaxed() {}
+    void pushed(int) {}
+};
+
+struct CountingSearchStats {
+    SearchStats counts;
+
+    void popped() { counts.pops++; }
+    void settled() { counts.settled++; }
+    void relaxed() { counts.relaxations++; }
+    void pushed(int queue_size) {
+        counts.pushes++;
+        counts.peak_queue_size = std::max<long>(counts.peak_queue_size, queue_size);
+    }
+};
+
+// finds the fastest path from startID to destID using the given workspace, returning false if there is none
+// optimalPath receives the street segments in driving order
+bool dijkstra(IntersectionIdx startID, IntersectionIdx destID, std::vector<StreetSegmentIdx>& optimalPath, double turn_penalty, SearchWorkspace& workspace);
+// the same search reporting to a statistics policy (instantiated for NoSearchStats and CountingSearchStats)
+template <class Stats>
+bool dijkstra(IntersectionIdx startID, IntersectionIdx destID, std::vector<StreetSegmentIdx>& optimalPath, double turn_penalty, SearchWorkspace& workspace, Stats& stats);
+
+// findPathBetweenIntersections that also reports what the search did
+std::vector<StreetSegmentIdx> findPathWithStats(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, SearchStats& stats);
+
+// Answers many findPathBetweenIntersections queries at once on the shared worker pool.
+// paths[i] is exactly what findPathBetweenIntersections(intersect_ids[i], turn_penalty) returns.
+std::vector<std::vector<StreetSegmentIdx>> findPathsBetweenIntersections(const std::vector<std::pair<IntersectionIdx, IntersectionIdx>>& intersect_ids, const double turn_penalty);
+
+// computePathTravelTime with the segment times of a traffic snapshot instead of the load-time ones, so it
+// matches searches run on that snapshot
+double computePathTravelTime(const std::vector<StreetSegmentIdx>& path, const double turn_penalty, const WeightSnapshot& weights);
+
+// an intersection an isochrone search reached and the travel time to it
+struct ReachedIntersection {
+    IntersectionIdx intersection;
+    double time;
+};
+
+// everything a driver can reach from a source within a time limit
+struct Isochrone {
+    // reachable intersections in order of increasing travel time, starting with the source
+    std::vector<ReachedIntersection> reached;
+    // segments that can be driven from end to end within the limit, sorted by id, for drawing the area
+    std::vector<StreetSegmentIdx> segments;
+};
+
+// runs dijkstra from source (obeying one-way streets and the turn penalty) but stops at time_limit seconds
+Isochrone findIsochrone(IntersectionIdx source, double time_limit, double turn_penalty);
+
+// alternative routes may take at most this fraction longer than the fastest route
+const double ALTERNATIVE_MAX_STRETCH = 0.25;
+// an alternative is dropped if more than this fraction of its travel time is on an already chosen route
+const double ALTERNATIVE_MAX_SHARED = 0.7;
+
+// a route option between two intersections
+struct AlternativeRoute {
+    std::vector<StreetSegmentIdx> path;
+    // travel time of the path (with turn penalties) at the traffic weights the routes were found with
+    double travel_time;
+};
+
+// Returns up to max_routes meaningfully different routes. The first is the path findPathBetweenIntersections
+// returns and the rest follow by travel time. They come from the plateau method: one forward search from
+// the start and one backward search from the destination, both cut off at (1 + ALTERNATIVE_MAX_STRETCH)
+// times the fastest time; the longest stretches where the two trees agree give the via routes.
+// Returns an empty vector if the destination cannot be reached.
+std::vector<AlternativeRoute> findAlternativeRoutes(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty, int max_routes = 3);
+
+// a path together with the clock times it is driven at
+struct TimedPath {
+    std::vector<StreetSegmentIdx> path;
+    double departure_time;
+    // when the destination is reached, infinity if it cannot be
+    double arrival_time;
+};
+
+// Fastest path when leaving the start at departure_time (seconds since midnight), with every segment driven
+// at the speed its profile (speedProfiles.h) gives for the moment the car enters it, relative to its speed in
+// the current traffic snapshot. The turn penalty is spent at the intersection before entering the next segment.
+TimedPath findTimeDependentPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, double departure_time, const double turn_penalty);
@@ -0,0 +1,52 @@
+#include <vector>
+
+#include "StreetsDatabaseAPI.h"
+#include "m1.h"
+#include "routingGraph.h"
+#include "trafficWeights.h"
+
+RoutingGraph routing_graph;
+// number of routing graphs built so far, used as the next map_id
+static unsigned graphs_built = 0;
+
+void loadRoutingGraph(){
+    int num_intersections = getNumIntersections();
+    int num_segments = getNumStreetSegments();
+
+    routing_graph.segment_time.resize(num_segments);
+    routing_graph.segment_street.resize(num_segments);
+    for (StreetSegmentIdx seg = 0; seg < num_segments; seg++){
+        routing_graph.segment_time[seg] = findStreetSegmentTravelTime(seg);
+        routing_graph.segment_street[seg] = getStreetSegmentInfo(seg).streetID;
+    }
+
+    routing_graph.map_id = ++graphs_built;
+    routing_graph.first_out.assign(1, 0);
+    routing_graph.first_in.assign(1, 0);
+    routing_graph.out_edges.clear();
+    routing_graph.in_edges.clear();
+    for (IntersectionIdx inter = 0; inter < num_intersections; inter++){
+        int num_connected = getNumIntersectionStreetSegment(inter);
+        for (int i = 0; i < num_connected; i++){
+            StreetSegmentIdx seg = getIntersectionStreetSegment(inter, i);
+            StreetSegmentInfo info = getStreetSegmentInfo(seg);
+            IntersectionIdx other = (info.from == inter) ? info.to : info.from;
+            // a one-way segment can only be driven out of its from end and into its to end
+            if (!info.oneWay || info.from == inter){
+                routing_graph.out_edges.push_back({other, seg});
+            }
+            if (!info.oneWay || info.to == inter){
+                routing_graph.in_edges.push_back({other, seg});
+            }
+        }
+        routing_graph.first_out.push_back(routing_graph.out_edges.size());
+        routing_graph.first_in.push_back(routing_graph.in_edges.size());
+    }
+    // live traffic starts out at free flow
+    resetWeights(routing_graph.segment_time);
+}
+
+void clearRoutingGraph(){
+    routing_graph = RoutingGraph();
+    clearWeights();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "StreetsDatabaseAPI.h"
+
+// a street segment as seen from one of its end intersections
+struct RoutingEdge {
+    // intersection at the other end of the segment
+    IntersectionIdx to;
+    StreetSegmentIdx segment;
+};
+
+// Compressed adjacency of the street network. It is built once per map by loadMap and only read
+// afterwards, so any number of searches can walk it at the same time.
+// The edges that can be driven out of intersection i are out_edges[first_out[i] .. first_out[i+1]),
+// in the same order as findStreetSegmentsOfIntersection. in_edges lists the segments that can be driven
+// into each intersection, with `to` holding the intersection they come from.
+struct RoutingGraph {
+    std::vector<int> first_out;
+    std::vector<RoutingEdge> out_edges;
+    std::vector<int> first_in;
+    std::vector<RoutingEdge> in_edges;
+    // free-flow travel time and street of every segment, indexed by StreetSegmentIdx
+    // (searches read the live travel times from currentWeights() instead)
+    std::vector<double> segment_time;
+    std::vector<StreetIdx> segment_street;
+    // changes every time a map is loaded so per-thread search state knows to resize
+    unsigned map_id = 0;
+
+    int numIntersections() const {
+        return first_out.empty() ? 0 : first_out.size() - 1;
+    }
+};
+
+// the routing graph of the loaded map
+extern RoutingGraph routing_graph;
+
+// builds routing_graph from the street database (needs the segment travel times from loadMap)
+void loadRoutingGraph();
+// frees the routing graph when the map is closed
+void clearRoutingGraph();
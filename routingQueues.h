@@ -0,0 +1,219 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+// Priority queues the path searches can run on. They share one interface:
+//   prepare(num_nodes)  size any per-node state for the loaded map (cheap when already sized)
+//   clear()             empty the queue, keeping its memory for the next search
+//   update(node, key)   insert a node or lower its key
+//   pop()               remove and return an entry with the smallest key
+//   size()              number of entries queued, stale ones included
+// Queues without decrease-key keep stale entries, so searches must skip nodes they have already settled
+// and take the current time from their own labels rather than from the popped key.
+
+struct QueueEntry {
+    double key;
+    int node;
+};
+
+// std::priority_queue style binary heap with lazy deletion; it grows by one entry per relaxation
+class BinaryHeapQueue {
+public:
+    void prepare(int) {}
+    void clear() { heap.clear(); }
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+
+    void update(int node, double key) {
+        heap.push_back({key, node});
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    QueueEntry pop() {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        QueueEntry top = heap.back();
+        heap.pop_back();
+        return top;
+    }
+
+private:
+    static bool later(const QueueEntry& a, const QueueEntry& b) { return a.key > b.key; }
+    std::vector<QueueEntry> heap;
+};
+
+// Indexed 4-ary heap with decrease-key: each node is in the heap at most once. The wider nodes make the
+// tree half as deep as a binary heap, and the four children sit next to each other in memory.
+class FourAryHeapQueue {
+public:
+    void prepare(int num_nodes) {
+        if ((int)position.size() != num_nodes) {
+            heap.clear();
+            position.assign(num_nodes, NOT_IN_HEAP);
+        }
+    }
+
+    // only the entries still queued have a position to undo, so this is O(queue size)
+    void clear() {
+        for (const QueueEntry& entry : heap) {
+            position[entry.node] = NOT_IN_HEAP;
+        }
+        heap.clear();
+    }
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+
+    void update(int node, double key) {
+        int pos = position[node];
+        if (pos == NOT_IN_HEAP) {
+            pos = heap.size();
+            heap.push_back({key, node});
+        } else if (key < heap[pos].key) {
+            heap[pos].key = key;
+        } else {
+            return;
+        }
+        siftUp(pos);
+    }
+
+    QueueEntry pop() {
+        QueueEntry top = heap[0];
+        position[top.node] = NOT_IN_HEAP;
+        QueueEntry last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0] = last;
+            siftDown(0);
+        }
+        return top;
+    }
+
+private:
+    static constexpr int NOT_IN_HEAP = -1;
+    static constexpr int ARITY = 4;
+
+    void place(int pos, const QueueEntry& entry) {
+        heap[pos] = entry;
+        position[entry.node] = pos;
+    }
+
+    void siftUp(int pos) {
+        QueueEntry entry = heap[pos];
+        while (pos > 0) {
+            int parent = (pos - 1) / ARITY;
+            if (heap[parent].key <= entry.key) {
+                break;
+            }
+            place(pos, heap[parent]);
+            pos = parent;
+        }
+        place(pos, entry);
+    }
+
+    void siftDown(int pos) {
+        QueueEntry entry = heap[pos];
+        int size = heap.size();
+        while (true) {
+            int first_child = pos * ARITY + 1;
+            if (first_child >= size) {
+                break;
+            }
+            int best = first_child;
+            int last_child = std::min(first_child + ARITY, size);
+            for (int child = first_child + 1; child < last_child; child++) {
+                if (heap[child].key < heap[best].key) {
+                    best = child;
+                }
+            }
+            if (entry.key <= heap[best].key) {
+                break;
+            }
+            place(pos, heap[best]);
+            pos = best;
+        }
+        place(pos, entry);
+    }
+
+    std::vector<QueueEntry> heap;
+    std::vector<int> position;
+};
+
+// Monotone radix heap over travel times rounded down to multiples of a quantum. Keys pushed must never be
+// below the last popped one, which holds for Dijkstra with non-negative weights. Entries live in 65 buckets
+// by the highest bit in which their quantized key differs from the last popped key, so each entry is
+// moved at most 64 times over its lifetime and no comparisons between entries are needed.
+// Entries within one quantum come out in arbitrary order, so the search is exact as long as the quantum is
+// no larger than the smallest segment travel time (plus turn penalty); otherwise a path can come out
+// slower than the optimum by about a quantum for every such out-of-order pop along it.
+class RadixHeapQueue {
+public:
+    explicit RadixHeapQueue(double quantum = DEFAULT_QUANTUM) : quantum(quantum) {}
+
+    void prepare(int) {}
+
+    void clear() {
+        for (std::vector<RadixEntry>& bucket : buckets) {
+            bucket.clear();
+        }
+        count = 0;
+        last_popped = 0;
+    }
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+
+    void update(int node, double key) {
+        uint64_t quantized = key / quantum;
+        buckets[bucketOf(quantized)].push_back({key, node, quantized});
+        count++;
+    }
+
+    QueueEntry pop() {
+        if (buckets[0].empty()) {
+            int i = 1;
+            while (buckets[i].empty()) {
+                i++;
+            }
+            // the smallest key of the first non-empty bucket becomes the reference point, which spreads
+            // that bucket's entries over lower buckets (at least one of them into bucket 0)
+            std::vector<RadixEntry> moving;
+            moving.swap(buckets[i]);
+            last_popped = moving[0].quantized;
+            for (const RadixEntry& entry : moving) {
+                last_popped = std::min(last_popped, entry.quantized);
+            }
+            for (const RadixEntry& entry : moving) {
+                buckets[bucketOf(entry.quantized)].push_back(entry);
+            }
+            // hand the memory back so the bucket does not reallocate next time
+            moving.clear();
+            moving.swap(buckets[i]);
+        }
+        RadixEntry top = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return {top.key, top.node};
+    }
+
+    // default rounding step in seconds, below the travel time of nearly every real street segment
+    static constexpr double DEFAULT_QUANTUM = 1e-3;
+
+private:
+    struct RadixEntry {
+        double key;
+        int node;
+        uint64_t quantized;
+    };
+
+    int bucketOf(uint64_t quantized) const {
+        return quantized == last_popped ? 0 : 64 - __builtin_clzll(quantized ^ last_popped);
+    }
+
+    double quantum;
+    std::array<std::vector<RadixEntry>, 65> buckets;
+    int count = 0;
+    uint64_t last_popped = 0;
+};
@@ -21,6 +21,7 @@
 #include "m1.h"
 #include "m2.h"
 #include "m3.h"
+#include "routingFunctions.h"
 #include "searchFunctions.h"
 #include "globals.h"
 #include "loadFunctions.h"
@@ -38,6 +39,9 @@ void hideWindow(GtkButton* /*self*/, ezgl::application* app);
 
 void openDirections(const char* message, ezgl::application* app);
 
+// Prints how much work a path search did, to tell why a route took long to find
+void logSearchStats(const SearchStats& stats);
+
 // Takes in 4 street names, finds its closest intersection and performs a path search on the two intersections
 void entered_search(GtkWidget* /*widget*/, ezgl::application* app){
     clearHighlights();
@@ -93,10 +97,12 @@ void entered_search(GtkWidget* /*widget*/, ezgl::application* app){
             srcID = two_street_intersections_pair1[0];
             destID = two_street_intersections_pair2[0];
             // highlight the start and end intersection 
-            intersection_map[srcID].highlight = true;
-            intersection_map[destID].highlight = true;
+            highlightIntersection(srcID, true);
+            highlightIntersection(destID, true);
             // get the path of street segments between the two intersections
-            std::vector<StreetSegmentIdx> path = findPathBetweenIntersections(std::pair(srcID, destID), 0);
+            SearchStats stats;
+            std::vector<StreetSegmentIdx> path = findPathWithStats(std::pair(srcID, destID), 0, stats);
+            logSearchStats(stats);
             std::cout<< "Drawing..." << std::endl;
             
             // if path is found, then show path
@@ -117,24 +123,29 @@ void entered_search(GtkWidget* /*widget*/, ezgl::application* app){
     }
     // displays message to status bar
     app->update_message(message);
-    app->refresh_drawing();
+    // showPath redraws the map around a path it shows; otherwise only the cleared highlights need redrawing
+    if (route.empty()){
+        app->refresh_overlay();
+    }
     
 }
 
 void searchUponClick(IntersectionIdx from, IntersectionIdx to, ezgl::application* app){  
-    std::vector<StreetSegmentIdx> path = findPathBetweenIntersections(std::pair(from, to), 0);
+    SearchStats stats;
+    std::vector<StreetSegmentIdx> path = findPathWithStats(std::pair(from, to), 0, stats);
+    logSearchStats(stats);
+    // showPath zooms to the path, which redraws the map
     std::vector<StreetSegment_Data> route = showPath(path, app, from, to);
     // std::cout<< "Starting Point: " << route[0].ss_id << std::endl;
-    app->refresh_drawing();
 }
 
 std::vector<StreetSegment_Data> showPath(std::vector<IntersectionIdx>& path, ezgl::application* app, IntersectionIdx srcID, IntersectionIdx destID){
     std::vector<StreetSegment_Data> route;
+    // the overlay draws the path in blue
+    highlighted_path = path;
     // iterate through each segment of the path
     for(int seg_num = 0; seg_num < path.size(); seg_num++){
         int ss_id = path[seg_num];
-        // highlight segment blue
-        street_segments[ss_id].highlight_path = true;
         // get street name for current and previous segment
         std::string street_name = street_segments[ss_id].street_name;
         std::string prev_street_name = "empty";
@@ -145,8 +156,6 @@ std::vector<StreetSegment_Data> showPath(std::vector<IntersectionIdx>& path, ezg
         // std::cout<< "Segment: " << seg_num << " street name- " << street_name << std::endl;
     }
     //printMessage(route, app);
-    // intersection connecting entered streets will now be purple 
-    app->flush_drawing();
 
     // gets the xy values of the src and dest intersections
     ezgl::point2d src_xy = intersection_map[srcID].xy_loc;
@@ -169,6 +178,8 @@ std::vector<StreetSegment_Data> showPath(std::vector<IntersectionIdx>& path, ezg
     // zooms in to the start intersection 
     double zoom_factor = calculateZoomFactor(src_xy, dest_xy, canvas_width, canvas_height);
 
+    // show the path right away, so the zoom animation moves it along with the map
+    app->refresh_overlay();
     zoomInOnPoint(midpoint, app, zoom_factor);
     return route;
 }
@@ -292,10 +303,8 @@ void zoomInOnPoint(ezgl::point2d point, ezgl::application* app, double zoomFacto
    double newX = point.x - newWidth / 2;
    double newY = point.y - newHeight / 2;
    ezgl::rectangle newWorld({newX, newY}, {newX + newWidth, newY + newHeight});
-   // Set the new world bounds
-   camera.set_world(newWorld);
-   // Refresh the canvas to display the new view
-   app->refresh_drawing();
+   // Move the view there over a few frames; the map is redrawn once, when it arrives
+   canvas->animate_to_world(newWorld);
 
 }
 
@@ -321,12 +330,29 @@ void delay (int milliseconds) { // Pause for milliseconds
 
 // Function clears all highlighted intersections and segments on the map and clears the search bars
 void  clearHighlights(){
-    int size = intersection_map.size();
-    for (int i = 0; i < size; i++){
-        intersection_map[i].highlight = false;
+    for (IntersectionIdx inter_id : highlighted_intersections){
+        intersection_map[inter_id].highlight = false;
+    }
+    highlighted_intersections.clear();
+    highlighted_path.clear();
+}
+
+// Function sets or clears the highlight of an intersection and keeps the list of highlighted intersections up to date
+void highlightIntersection(IntersectionIdx inter_id, bool highlight){
+    Intersection_data& intersection = intersection_map[inter_id];
+    if (intersection.highlight == highlight){
+        return;
     }
-    int segment_size = street_segments.size();
-    for (int i = 0; i < segment_size; i++){
-        street_segments[i].highlight_path = false;
+    intersection.highlight = highlight;
+    if (highlight){
+        highlighted_intersections.push_back(inter_id);
+    } else {
+        highlighted_intersections.erase(std::find(highlighted_intersections.begin(), highlighted_intersections.end(), inter_id));
     }
-}
\ No newline at end of file
+}
+
+void logSearchStats(const SearchStats& stats){
+    std::cout << "Path search settled " << stats.settled << " intersections, relaxed " << stats.relaxations
+              << " segments, " << stats.pushes << " pushes / " << stats.pops << " pops, peak queue "
+              << stats.peak_queue_size << std::endl;
+}
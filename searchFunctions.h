@@ -17,6 +17,8 @@ void zoomInOnPoint(ezgl::point2d point, ezgl::application* app, double zoomFacto
 double calculateZoomFactor(const ezgl::point2d& src_point, const ezgl::point2d& dest_point, double canvas_width, double canvas_height);
 // Function clears all the highlights on the map
 void clearHighlights();
+// Function highlights an intersection, or removes its highlight
+void highlightIntersection(IntersectionIdx inter_id, bool highlight);
 // Function creates the delay for the given time
 void delay (int milliseconds);
 // Call back function for the searching a path on a rightclick
@@ -0,0 +1,156 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <unordered_map>
+
+#include "StreetsDatabaseAPI.h"
+#include "OSMDatabaseAPI.h"
+#include "speedProfiles.h"
+
+SpeedProfileStore speed_profiles;
+
+// the profile every segment uses until a file says otherwise
+static SpeedProfile freeFlowProfile(){
+    SpeedProfile profile;
+    profile.speed_percent.fill(100);
+    return profile;
+}
+
+// highway tag of every way that has one, to find each segment's road class
+static std::unordered_map<OSMID, std::string> loadWayHighwayTags(){
+    std::unordered_map<OSMID, std::string> highway_tags;
+    int num_ways = getNumberOfWays();
+    for (int way_idx = 0; way_idx < num_ways; way_idx++){
+        const OSMWay* way = getWayByIndex(way_idx);
+        int tag_count = getTagCount(way);
+        for (int tag_num = 0; tag_num < tag_count; tag_num++){
+            std::pair<std::string, std::string> tag = getTagPair(way, tag_num);
+            if (tag.first == "highway"){
+                highway_tags[way->id()] = tag.second;
+                break;
+            }
+        }
+    }
+    return highway_tags;
+}
+
+bool loadSpeedProfiles(const std::string& profile_path){
+    std::ifstream file(profile_path);
+    if (!file){
+        std::cout << "Could not open speed profile file " << profile_path << std::endl;
+        return false;
+    }
+
+    SpeedProfileStore store;
+    store.profiles.push_back(freeFlowProfile());
+    std::unordered_map<std::string, uint16_t> profile_index;
+    std::unordered_map<std::string, uint16_t> class_profile;
+    std::vector<std::pair<StreetSegmentIdx, uint16_t>> overrides;
+    int num_segments = getNumStreetSegments();
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)){
+        line_number++;
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#'){
+            continue;
+        }
+        bool valid = true;
+        if (kind == "profile"){
+            std::string name;
+            SpeedProfile profile;
+            valid = (bool)(fields >> name);
+            for (int bucket = 0; valid && bucket < PROFILE_BUCKETS; bucket++){
+                int percent;
+                // at least 1% so a car always gets off the segment eventually
+                valid = (fields >> percent) && percent >= 1 && percent <= 255;
+                profile.speed_percent[bucket] = percent;
+            }
+            // the index has to fit in a segment's two bytes
+            if (valid && store.profiles.size() > UINT16_MAX){
+                std::cout << "Too many speed profiles in " << profile_path << std::endl;
+                return false;
+            }
+            if (valid){
+                profile_index[name] = store.profiles.size();
+                store.profiles.push_back(profile);
+            }
+        } else if (kind == "class" || kind == "segment"){
+            std::string target, name;
+            valid = (fields >> target >> name) && profile_index.count(name);
+            if (valid && kind == "class"){
+                class_profile[target] = profile_index[name];
+            } else if (valid){
+                std::istringstream id_field(target);
+                StreetSegmentIdx seg;
+                valid = (id_field >> seg) && id_field.eof() && seg >= 0 && seg < num_segments;
+                overrides.push_back({seg, profile_index[name]});
+            }
+        } else {
+            valid = false;
+        }
+        if (!valid){
+            std::cout << profile_path << ":" << line_number << ": invalid speed profile line" << std::endl;
+            return false;
+        }
+    }
+
+    store.segment_profile.assign(num_segments, 0);
+    if (!class_profile.empty()){
+        std::unordered_map<OSMID, std::string> highway_tags = loadWayHighwayTags();
+        for (StreetSegmentIdx seg = 0; seg < num_segments; seg++){
+            auto tag = highway_tags.find(getStreetSegmentInfo(seg).wayOSMID);
+            if (tag == highway_tags.end()){
+                continue;
+            }
+            auto profile = class_profile.find(tag->second);
+            if (profile != class_profile.end()){
+                store.segment_profile[seg] = profile->second;
+            }
+        }
+    }
+    for (const auto& [seg, profile] : overrides){
+        store.segment_profile[seg] = profile;
+    }
+
+    speed_profiles = std::move(store);
+    return true;
+}
+
+void clearSpeedProfiles(){
+    speed_profiles = SpeedProfileStore();
+}
+
+double timeDependentTravelTime(StreetSegmentIdx street_segment_id, double departure_time, const WeightSnapshot& weights){
+    // live traffic replaces the speed limit as the 100% the profile is relative to
+    double base_time = weights.time(street_segment_id);
+    if (speed_profiles.segment_profile.empty()){
+        return base_time;
+    }
+    const SpeedProfile& profile = speed_profiles.profiles[speed_profiles.segment_profile[street_segment_id]];
+
+    // drive through the buckets at each one's speed until the base time's worth of road is covered
+    double clock = std::fmod(departure_time, SECONDS_PER_DAY);
+    if (clock < 0){
+        clock += SECONDS_PER_DAY;
+    }
+    int bucket = std::min((int)(clock / PROFILE_BUCKET_SECONDS), PROFILE_BUCKETS - 1);
+    double bucket_left = (bucket + 1) * PROFILE_BUCKET_SECONDS - clock;
+    double road_left = base_time;
+    double elapsed = 0;
+    while (true){
+        double speed = profile.speed_percent[bucket] / 100.0;
+        if (speed * bucket_left >= road_left){
+            return elapsed + road_left / speed;
+        }
+        road_left -= speed * bucket_left;
+        elapsed += bucket_left;
+        bucket = (bucket + 1) % PROFILE_BUCKETS;
+        bucket_left = PROFILE_BUCKET_SECONDS;
+    }
+}
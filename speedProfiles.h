@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+#include "StreetsDatabaseAPI.h"
+#include "trafficWeights.h"
+
+// a day is split into 96 buckets of 15 minutes
+const int PROFILE_BUCKETS = 96;
+const double PROFILE_BUCKET_SECONDS = 900;
+const double SECONDS_PER_DAY = PROFILE_BUCKETS * PROFILE_BUCKET_SECONDS;
+
+// Driving speed over a day as a percentage of the segment's current speed (the speed limit, or the live
+// traffic speed once updates arrive, see trafficWeights.h), constant within each bucket. Because a car
+// on a segment always moves at the speed of the current bucket, a later departure can never arrive earlier
+// (FIFO), and the travel time is piecewise linear in the departure time.
+struct SpeedProfile {
+    std::array<uint8_t, PROFILE_BUCKETS> speed_percent;
+};
+
+// Profiles are shared: road classes (OSM highway values) point at one profile each and only segments with
+// their own override get a different index, so each segment costs two bytes.
+struct SpeedProfileStore {
+    // profile 0 is free flow (100% all day) and is used by every segment without a profile
+    std::vector<SpeedProfile> profiles;
+    // profile index of every segment, empty until a profile file is loaded
+    std::vector<uint16_t> segment_profile;
+};
+
+// the speed profiles of the loaded map
+extern SpeedProfileStore speed_profiles;
+
+// Loads a profile file for the loaded map. Lines are
+//   profile <name> <96 speed percentages>   defines a profile, starting at midnight
+//   class <highway value> <profile name>    e.g. "class motorway rush_hour"
+//   segment <segment id> <profile name>     overrides the class profile of one segment
+// Blank lines and lines starting with '#' are skipped. Returns false (keeping free flow) if the file cannot
+// be read or is malformed.
+bool loadSpeedProfiles(const std::string& profile_path);
+// resets every segment to free flow
+void clearSpeedProfiles();
+
+// seconds needed to drive a segment when entering it at departure_time (seconds since midnight, wraps daily):
+// its travel time in the weight snapshot, stretched or shrunk by its profile
+double timeDependentTravelTime(StreetSegmentIdx street_segment_id, double departure_time, const WeightSnapshot& weights);
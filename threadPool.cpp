@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+WorkStealingPool& WorkStealingPool::instance(){
+    static WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned num_workers){
+    for (unsigned i = 0; i < num_workers; i++){
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 0; i < num_workers; i++){
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    {
+        std::lock_guard<std::mutex> state(state_lock);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (std::thread& worker : workers){
+        worker.join();
+    }
+}
+
+void WorkStealingPool::parallelFor(int count, const std::function<void(int, unsigned)>& task){
+    if (count <= 0){
+        return;
+    }
+    std::lock_guard<std::mutex> job(job_lock);
+
+    // hand each worker a contiguous block so neighbouring indices mostly stay on one thread
+    unsigned num_workers = workers.size();
+    for (unsigned w = 0; w < num_workers; w++){
+        int begin = (long long)count * w / num_workers;
+        int end = (long long)count * (w + 1) / num_workers;
+        std::lock_guard<std::mutex> queue(queues[w]->lock);
+        for (int index = begin; index < end; index++){
+            queues[w]->indices.push_back(index);
+        }
+    }
+
+    std::unique_lock<std::mutex> state(state_lock);
+    current_task = &task;
+    finished_workers = 0;
+    job_id++;
+    job_ready.notify_all();
+    // waiting for every worker (not just every index) guarantees none is still scanning the queues
+    // when the next job fills them
+    job_done.wait(state, [&]{ return finished_workers == num_workers; });
+    current_task = nullptr;
+}
+
+void WorkStealingPool::workerLoop(unsigned worker){
+    unsigned seen_job = 0;
+    while (true){
+        const std::function<void(int, unsigned)>* task;
+        {
+            std::unique_lock<std::mutex> state(state_lock);
+            job_ready.wait(state, [&]{ return stopping || job_id != seen_job; });
+            if (stopping){
+                return;
+            }
+            seen_job = job_id;
+            task = current_task;
+        }
+
+        int index;
+        while (takeIndex(worker, index)){
+            (*task)(index, worker);
+        }
+
+        {
+            std::lock_guard<std::mutex> state(state_lock);
+            finished_workers++;
+        }
+        job_done.notify_one();
+    }
+}
+
+bool WorkStealingPool::takeIndex(unsigned worker, int& index){
+    {
+        WorkQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> queue(own.lock);
+        if (!own.indices.empty()){
+            index = own.indices.front();
+            own.indices.pop_front();
+            return true;
+        }
+    }
+    // steal from the far end of someone else's block
+    unsigned num_workers = queues.size();
+    for (unsigned offset = 1; offset < num_workers; offset++){
+        WorkQueue& victim = *queues[(worker + offset) % num_workers];
+        std::lock_guard<std::mutex> queue(victim.lock);
+        if (!victim.indices.empty()){
+            index = victim.indices.back();
+            victim.indices.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// A fixed set of worker threads that stay alive between jobs. parallelFor deals the indices of a job out
+// into one deque per worker; each worker pops from the front of its own deque and, once that runs dry,
+// steals from the back of the others, so a few slow tasks do not leave the other threads idle.
+class WorkStealingPool {
+public:
+    // the process-wide pool, sized to the hardware thread count on first use
+    static WorkStealingPool& instance();
+
+    explicit WorkStealingPool(unsigned num_workers);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return workers.size(); }
+
+    // runs task(index, worker) for every index in [0, count) and returns once all of them are done
+    // worker is in [0, size()) and names the thread running the task, e.g. to pick a per-thread scratch buffer
+    // tasks must not throw or call parallelFor themselves
+    void parallelFor(int count, const std::function<void(int, unsigned)>& task);
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> indices;
+    };
+
+    void workerLoop(unsigned worker);
+    // takes the next index from the worker's own queue, or steals one; false once every queue is empty
+    bool takeIndex(unsigned worker, int& index);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+    // only one parallelFor runs at a time
+    std::mutex job_lock;
+    std::mutex state_lock;
+    std::condition_variable job_ready;
+    std::condition_variable job_done;
+    const std::function<void(int, unsigned)>* current_task = nullptr;
+    unsigned job_id = 0;
+    // workers that have run out of indices for the current job
+    unsigned finished_workers = 0;
+    bool stopping = false;
+};
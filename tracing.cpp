@@ -0,0 +1,147 @@
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tracing.h"
+
+// set before main runs, so the spans of the first loadMap can be captured
+std::atomic<bool> tracing_enabled(std::getenv(TRACE_ENV_VAR) != nullptr);
+
+struct TraceSpan {
+    const char* name;
+    long long start_ns;
+    long long end_ns;
+};
+
+// One span of a ring buffer. The owning thread writes it while dumpTrace may be reading it, so every field is
+// atomic and seq says which span the slot holds: the span's index + 1 once it is complete, 0 while it is
+// being rewritten. A reader that sees the same seq before and after reading the fields has a whole span.
+struct TraceSlot {
+    std::atomic<unsigned long long> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<long long> start_ns{0};
+    std::atomic<long long> end_ns{0};
+};
+
+// Written only by its own thread. head counts every span ever recorded.
+struct TraceBuffer {
+    std::array<TraceSlot, TRACE_BUFFER_SIZE> slots;
+    std::atomic<unsigned long long> head{0};
+    int thread_index = 0;
+};
+
+// every thread's buffer, kept alive after the thread exits so its spans still make it into the dump
+static std::mutex registry_lock;
+static std::vector<std::shared_ptr<TraceBuffer>> registry;
+// spans that start before this belong to an earlier session
+static std::atomic<long long> session_start(0);
+static const std::chrono::steady_clock::time_point trace_origin = std::chrono::steady_clock::now();
+
+// the calling thread's buffer, registered on its first span (the only time recording takes a lock)
+static TraceBuffer& threadBuffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<TraceBuffer>();
+        std::lock_guard<std::mutex> registering(registry_lock);
+        buffer->thread_index = registry.size();
+        registry.push_back(buffer);
+    }
+    return *buffer;
+}
+
+long long traceClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_origin).count();
+}
+
+void setTracingEnabled(bool enabled) {
+    if (enabled && !tracingEnabled()) {
+        session_start.store(traceClock(), std::memory_order_relaxed);
+    }
+    tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void recordSpan(const char* name, long long start_ns, long long end_ns) {
+    TraceBuffer& buffer = threadBuffer();
+    unsigned long long head = buffer.head.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.slots[head % TRACE_BUFFER_SIZE];
+    // mark the slot as being rewritten before any field changes
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.seq.store(head + 1, std::memory_order_release);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+// copies span index out of its slot, returning false if the slot no longer holds it or was being rewritten
+static bool readSpan(const TraceBuffer& buffer, unsigned long long index, TraceSpan& span) {
+    const TraceSlot& slot = buffer.slots[index % TRACE_BUFFER_SIZE];
+    if (slot.seq.load(std::memory_order_acquire) != index + 1) {
+        return false;
+    }
+    span = {slot.name.load(std::memory_order_relaxed), slot.start_ns.load(std::memory_order_relaxed),
+            slot.end_ns.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == index + 1;
+}
+
+// span names are string literals, but quotes or backslashes would still break the JSON
+static std::string jsonEscape(const char* text) {
+    std::string escaped;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        escaped += *c;
+    }
+    return escaped;
+}
+
+bool dumpTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    long long start = session_start.load(std::memory_order_relaxed);
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> reading(registry_lock);
+        buffers = registry;
+    }
+
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first_event = true;
+    for (const std::shared_ptr<TraceBuffer>& buffer : buffers) {
+        unsigned long long head = buffer->head.load(std::memory_order_acquire);
+        unsigned long long oldest = head > (unsigned long long)TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+        std::vector<TraceSpan> spans;
+        for (unsigned long long i = oldest; i < head; i++) {
+            TraceSpan span;
+            // torn or already overwritten by the owning thread wrapping around
+            if (readSpan(*buffer, i, span)) {
+                spans.push_back(span);
+            }
+        }
+        for (const TraceSpan& span : spans) {
+            if (span.start_ns < start) {
+                continue;
+            }
+            // complete events ("ph":"X") with times in microseconds
+            out << (first_event ? "" : ",") << "\n{\"name\":\"" << jsonEscape(span.name) << "\",\"ph\":\"X\",\"pid\":1"
+                << ",\"tid\":" << buffer->thread_index << ",\"ts\":" << span.start_ns / 1000.0
+                << ",\"dur\":" << (span.end_ns - span.start_ns) / 1000.0 << "}";
+            first_event = false;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool)out;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Scoped-timer tracing. TRACE_SCOPE("name") records a span from that line to the end of the enclosing scope
+// into a ring buffer owned by the calling thread, so recording takes no lock and never blocks on I/O.
+// Tracing is off until setTracingEnabled(true), or from startup if the TRACE_ENV_VAR environment variable is set
+// (which is the only way to trace the first map load); while off a scope costs one relaxed atomic load.
+// Building with -DDISABLE_TRACING removes the scopes entirely.
+// dumpTrace writes the spans in Chrome's trace event format (load it in chrome://tracing or Perfetto).
+
+// spans kept per thread; older spans are overwritten once a thread records more than this
+const int TRACE_BUFFER_SIZE = 1 << 16;
+// tracing starts on at program start when this environment variable is set (to anything)
+const char* const TRACE_ENV_VAR = "MAPPER_TRACE";
+
+extern std::atomic<bool> tracing_enabled;
+
+inline bool tracingEnabled() {
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+// turning tracing on starts a new session: dumpTrace only writes spans that began after it
+void setTracingEnabled(bool enabled);
+
+// nanoseconds on the steady clock since the program started
+long long traceClock();
+// adds a finished span to the calling thread's buffer; name must outlive the program (a string literal)
+void recordSpan(const char* name, long long start_ns, long long end_ns);
+
+// writes the current session's spans from every thread, returning false if the file cannot be written
+// spans recorded while the dump runs may be left out
+bool dumpTrace(const std::string& path);
+
+// records the time between its construction and destruction if tracing was on when it was constructed
+class TraceScope {
+public:
+    explicit TraceScope(const char* span_name) {
+        if (tracingEnabled()) {
+            name = span_name;
+            start_ns = traceClock();
+        }
+    }
+    ~TraceScope() {
+        if (name != nullptr) {
+            recordSpan(name, start_ns, traceClock());
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name = nullptr;
+    long long start_ns = 0;
+};
+
+#ifndef DISABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,145 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#include "StreetsDatabaseAPI.h"
+#include "m1.h"
+#include "trafficWeights.h"
+
+// the published snapshot, only accessed through the std::atomic_load/atomic_store overloads
+static std::shared_ptr<const WeightSnapshot> current_weights;
+// serializes publishers and guards the listener list
+static std::mutex publish_lock;
+static std::map<int, WeightListener> weight_listeners;
+static int next_listener_id = 0;
+
+std::shared_ptr<const WeightSnapshot> currentWeights(){
+    return std::atomic_load(&current_weights);
+}
+
+void resetWeights(const std::vector<double>& segment_times){
+    std::lock_guard<std::mutex> publish(publish_lock);
+    std::shared_ptr<const WeightSnapshot> previous = std::atomic_load(&current_weights);
+
+    auto snapshot = std::make_shared<WeightSnapshot>();
+    snapshot->snapshot_version = previous ? previous->snapshot_version + 1 : 1;
+    int num_segments = segment_times.size();
+    for (int first = 0; first < num_segments; first += WEIGHT_PAGE_SIZE){
+        auto page = std::make_shared<WeightSnapshot::WeightPage>();
+        page->fill(0);
+        for (int i = 0; i < WEIGHT_PAGE_SIZE && first + i < num_segments; i++){
+            (*page)[i] = segment_times[first + i];
+        }
+        snapshot->pages.push_back(std::move(page));
+    }
+    std::atomic_store(&current_weights, std::shared_ptr<const WeightSnapshot>(std::move(snapshot)));
+}
+
+void clearWeights(){
+    std::lock_guard<std::mutex> publish(publish_lock);
+    std::atomic_store(&current_weights, std::shared_ptr<const WeightSnapshot>());
+}
+
+void applyTrafficUpdates(const std::vector<TrafficUpdate>& updates){
+    std::lock_guard<std::mutex> publish(publish_lock);
+    std::shared_ptr<const WeightSnapshot> previous = std::atomic_load(&current_weights);
+    if (!previous || updates.empty()){
+        return;
+    }
+
+    // start from the previous snapshot's pages and copy each page the first time an update touches it
+    auto snapshot = std::make_shared<WeightSnapshot>(*previous);
+    snapshot->snapshot_version = previous->snapshot_version + 1;
+    // pages copied for this update; they are written through these pointers until the snapshot is published
+    std::vector<std::shared_ptr<WeightSnapshot::WeightPage>> copies(snapshot->pages.size());
+    std::vector<StreetSegmentIdx> changed;
+    for (const TrafficUpdate& update : updates){
+        int page_idx = update.segment / WEIGHT_PAGE_SIZE;
+        if (update.segment < 0 || page_idx >= (int)snapshot->pages.size() || update.speed <= 0){
+            continue;
+        }
+        double travel_time = findStreetSegmentLength(update.segment) / update.speed;
+        if (travel_time == snapshot->time(update.segment)){
+            continue;
+        }
+        if (!copies[page_idx]){
+            copies[page_idx] = std::make_shared<WeightSnapshot::WeightPage>(*snapshot->pages[page_idx]);
+            snapshot->pages[page_idx] = copies[page_idx];
+        }
+        (*copies[page_idx])[update.segment % WEIGHT_PAGE_SIZE] = travel_time;
+        changed.push_back(update.segment);
+    }
+    if (changed.empty()){
+        return;
+    }
+
+    std::shared_ptr<const WeightSnapshot> published = std::move(snapshot);
+    std::atomic_store(&current_weights, published);
+    for (auto& [listener_id, listener] : weight_listeners){
+        listener(published, changed);
+    }
+}
+
+int addWeightListener(WeightListener listener){
+    std::lock_guard<std::mutex> publish(publish_lock);
+    weight_listeners[next_listener_id] = std::move(listener);
+    return next_listener_id++;
+}
+
+void removeWeightListener(int listener_id){
+    std::lock_guard<std::mutex> publish(publish_lock);
+    weight_listeners.erase(listener_id);
+}
+
+int replayTrafficFile(const std::string& traffic_path, double playback_speed){
+    std::ifstream file(traffic_path);
+    if (!file){
+        std::cout << "Could not open traffic file " << traffic_path << std::endl;
+        return -1;
+    }
+
+    // read everything first so a malformed line never leaves half a log applied
+    std::vector<std::pair<double, std::vector<TrafficUpdate>>> batches;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)){
+        line_number++;
+        std::istringstream fields(line);
+        // blank lines and '#' comments are the only lines that are not updates
+        fields >> std::ws;
+        if (fields.eof() || fields.peek() == '#'){
+            continue;
+        }
+        double timestamp;
+        TrafficUpdate update;
+        bool valid = (bool)(fields >> timestamp >> update.segment >> update.speed);
+        // nothing may follow the three fields, and the log must not go back in time
+        valid = valid && (fields >> std::ws).eof();
+        valid = valid && update.segment >= 0 && update.segment < getNumStreetSegments() && update.speed > 0;
+        valid = valid && (batches.empty() || timestamp >= batches.back().first);
+        if (!valid){
+            std::cout << traffic_path << ":" << line_number << ": invalid traffic update" << std::endl;
+            return -1;
+        }
+        if (batches.empty() || batches.back().first != timestamp){
+            batches.push_back({timestamp, {}});
+        }
+        batches.back().second.push_back(update);
+    }
+
+    auto replay_start = std::chrono::steady_clock::now();
+    for (const auto& [timestamp, updates] : batches){
+        if (playback_speed > 0){
+            double offset = (timestamp - batches.front().first) / playback_speed;
+            std::this_thread::sleep_until(replay_start + std::chrono::duration<double>(offset));
+        }
+        applyTrafficUpdates(updates);
+    }
+    return batches.size();
+}
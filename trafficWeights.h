@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <functional>
+#include <string>
+#include "StreetsDatabaseAPI.h"
+
+// number of segment travel times per copy-on-write page
+const int WEIGHT_PAGE_SIZE = 4096;
+
+// a new observed speed (m/s, like StreetSegmentInfo::speedLimit) on one segment
+struct TrafficUpdate {
+    StreetSegmentIdx segment;
+    double speed;
+};
+
+// The travel time of every segment at one moment. Snapshots are never modified once published: a traffic
+// update builds a new snapshot that shares every page it does not touch with the previous one, so an update
+// of a few thousand segments copies a few pages instead of the whole array.
+class WeightSnapshot {
+public:
+    double time(StreetSegmentIdx seg) const {
+        return (*pages[seg / WEIGHT_PAGE_SIZE])[seg % WEIGHT_PAGE_SIZE];
+    }
+    // increases with every published snapshot
+    unsigned version() const { return snapshot_version; }
+
+private:
+    friend void resetWeights(const std::vector<double>& segment_times);
+    friend void applyTrafficUpdates(const std::vector<TrafficUpdate>& updates);
+
+    typedef std::array<double, WEIGHT_PAGE_SIZE> WeightPage;
+    std::vector<std::shared_ptr<const WeightPage>> pages;
+    unsigned snapshot_version = 0;
+};
+
+// called after each published update with the new snapshot and the segments whose travel time changed
+// (the snapshot comes as a shared_ptr so listeners can keep it alive alongside data derived from it)
+typedef std::function<void(const std::shared_ptr<const WeightSnapshot>&, const std::vector<StreetSegmentIdx>&)> WeightListener;
+
+// The current travel times. Searches take one snapshot when they start and use it throughout, so they
+// never see an update half applied and never block the thread publishing updates.
+std::shared_ptr<const WeightSnapshot> currentWeights();
+
+// publishes the free-flow travel times of a newly loaded map (called by loadRoutingGraph)
+void resetWeights(const std::vector<double>& segment_times);
+// drops all snapshots when the map is closed
+void clearWeights();
+
+// publishes a snapshot with the new speeds applied and then notifies the listeners
+// updates are applied one batch at a time; listeners must not publish updates themselves
+void applyTrafficUpdates(const std::vector<TrafficUpdate>& updates);
+
+// registers a structure that derives data from the weights (e.g. an overlay) so it can refresh the
+// affected parts; returns an id for removeWeightListener
+int addWeightListener(WeightListener listener);
+void removeWeightListener(int listener_id);
+
+// Replays a traffic log with lines "<seconds> <segment id> <speed m/s>" in time order (blank lines and lines
+// starting with '#' are skipped; any other line that is not an update is an error). Updates with the
+// same timestamp are published together. With playback_speed > 0 the replay sleeps so that the log plays
+// back that many times faster than real time; 0 plays it as fast as possible.
+// Returns the number of batches published, or -1 if the file cannot be read or a line is malformed.
+int replayTrafficFile(const std::string& traffic_path, double playback_speed = 0);